@@ -0,0 +1,95 @@
+//POSIX web server with the interface of the ESP8266 core's synchronous server, on a non-blocking socket and epoll.
+//handleClient() accepts and reads whatever is ready without blocking, then serves one complete request, like the ESP8266 server.
+//Connections are kept alive (HTTP/1.1) and requests pipelined on them are served in order, until they are idle for idleTimeout
+#ifndef ESP8266WebServer_h
+#define ESP8266WebServer_h
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+
+class ESP8266WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+  static const size_t requestLimit = 16 * 1024; //larger requests close the connection
+
+  unsigned long idleTimeout = 30000; //ms a connection may stay open without traffic, 0 for no limit
+
+  ESP8266WebServer(int port = 80) : port(port) {}
+  ESP8266WebServer(IPAddress addr, int port = 80) : port(port), address(addr) {}
+  ~ESP8266WebServer() { close(); }
+
+  void on(const String& uri, HTTPMethod method, THandlerFunction fn) { routes.push_back(Route{uri.c_str(), method, fn}); }
+  void on(const String& uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+  void onNotFound(THandlerFunction fn) { notFound = fn; }
+  void collectHeaders(const char* headerKeys[], const size_t count)
+  {
+    collected.clear();
+    for (size_t i = 0; i < count; i++) collected.push_back(headerKeys[i]);
+  }
+  void begin();
+  void close();
+  void handleClient();
+
+  void send(int code, const char* type = nullptr, const String& content = String(""));
+  void send(int code, const char* type, const char* content) { send(code, type, String(content)); }
+  void send(int code, const String& type, const String& content) { send(code, type.c_str(), content); }
+  void sendHeader(const String& name, const String& value, bool first = false);
+  void setContentLength(size_t len) { contentLength = len; }
+  void sendContent(const String& s) { sendContent(s.c_str(), s.length()); }
+  void sendContent(const char* s) { sendContent(s, strlen(s)); }
+  void sendContent(const char* s, size_t len);
+
+  String uri() { return cur.uri.c_str(); }
+  HTTPMethod method() { return cur.method; }
+  int args() { return cur.body.empty() ? 0 : 1; }
+  String arg(int i) { return i == 0 ? String(cur.body.c_str()) : String(); }
+  String arg(const String& name) { return name == "plain" ? String(cur.body.c_str()) : String(); }
+  bool hasHeader(const String& name) { return header(name).length() > 0; }
+  String header(const String& name);
+  WiFiClient& client() { return currentClient; }
+
+  int fd() { return epoll; }                  //readable when a connection has data, for poll() in the main loop
+  bool pending() { return !ready.empty(); }   //complete requests are waiting for handleClient()
+
+private:
+  struct Route { std::string uri; HTTPMethod method; THandlerFunction fn; };
+  struct Request {
+    HTTPMethod method = HTTP_GET;
+    std::string uri, body;
+    std::vector<std::pair<std::string, std::string>> headers;
+    bool keepAlive = true, http11 = true;
+  };
+
+  int port;
+  IPAddress address; //0.0.0.0 for all addresses
+  int listener = -1, epoll = -1;
+  std::vector<Route> routes;
+  THandlerFunction notFound;
+  std::vector<std::string> collected;
+  std::unordered_map<int, std::shared_ptr<WiFiClient::Connection>> conns;
+  std::deque<std::shared_ptr<WiFiClient::Connection>> ready;
+  Request cur;
+  WiFiClient currentClient;
+  std::string pendingHeaders;
+  size_t contentLength = 0;
+  bool chunked = false;
+  unsigned long lastSweep = 0;
+
+  void poll();
+  void sweep();
+  void accept();
+  void receive(std::shared_ptr<WiFiClient::Connection> c);
+  void drop(int fd);
+  bool complete(const std::string& in, size_t& headerEnd, size_t& bodyLen);
+  void parse(WiFiClient::Connection& c);
+  void dispatch();
+};
+
+#endif
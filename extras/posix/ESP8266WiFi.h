@@ -0,0 +1,28 @@
+//POSIX stand-in for the WiFi interface: the address and MAC of a network interface of this machine
+#ifndef ESP8266WiFi_h
+#define ESP8266WiFi_h
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+class WiFiClass {
+public:
+  uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+  IPAddress ip = IPAddress(127, 0, 0, 1);
+
+  //takes IP and MAC of interface name, e.g. "eth0". Returns false if it has no IPv4 address.
+  //Interfaces without a MAC (loopback) keep the locally administered default
+  bool useInterface(const char* name);
+
+  uint8_t* macAddress(uint8_t* m) { memcpy(m, mac, 6); return m; }
+  String macAddress()
+  {
+    char s[18];
+    sprintf(s, "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return s;
+  }
+  IPAddress localIP() { return ip; }
+};
+extern WiFiClass WiFi;
+
+#endif
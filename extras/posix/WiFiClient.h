@@ -0,0 +1,50 @@
+//POSIX TCP client: a connection accepted by the epoll server. Copies share the connection, like WiFiClient on the ESP cores
+#ifndef WiFiClient_h
+#define WiFiClient_h
+
+#include "Arduino.h"
+#include <memory>
+
+class WiFiClient : public Stream {
+public:
+  static const size_t outputLimit = 64 * 1024; //bytes buffered for a slow peer, writes beyond it are lost
+
+  struct Connection {
+    int fd = -1;
+    int epoll = -1;             //epoll set of the server, to wait for the socket to become writable
+    bool connected = true;      //false once either side closed it
+    bool closeAfterWrite = false;
+    bool waitingForWrite = false;
+    bool ready = false;         //in the server's queue of connections with a complete request
+    unsigned long lastActive = 0; //millis() when bytes were last received or sent
+    std::string in, out;        //received bytes not yet served, and bytes not yet sent
+    void flush();               //sends as much of out as the socket takes
+    void close();
+  };
+  std::shared_ptr<Connection> conn;
+
+  WiFiClient() {}
+  explicit WiFiClient(std::shared_ptr<Connection> c) : conn(c) {}
+
+  uint8_t connected() { return conn && conn->connected; }
+  operator bool() { return conn != nullptr; }
+  void stop() { if (conn) conn->close(); }
+  int available() override { return connected() ? conn->in.size() : 0; }
+  int read() override { return -1; }
+  void flush() { if (connected()) conn->flush(); }
+  void setNoDelay(bool n);
+  size_t availableForWrite() { return connected() && conn->out.size() < outputLimit ? outputLimit - conn->out.size() : 0; }
+
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t len) override
+  {
+    if (len > availableForWrite()) len = availableForWrite();
+    if (len == 0) return 0;
+    conn->out.append((const char*)buf, len);
+    conn->flush();
+    return len;
+  }
+};
+
+#endif
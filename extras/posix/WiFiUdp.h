@@ -0,0 +1,40 @@
+//POSIX UDP socket: SSDP multicast group membership, non-blocking receive and replies with sendto()
+#ifndef WiFiUdp_h
+#define WiFiUdp_h
+
+#include "Arduino.h"
+
+class WiFiUDP : public Print {
+public:
+  WiFiUDP() {}
+  ~WiFiUDP() { stop(); }
+
+  uint8_t beginMulticast(IPAddress iface, IPAddress group, uint16_t port);
+  uint8_t beginMulticast(IPAddress group, uint16_t port) { return beginMulticast(IPAddress(0, 0, 0, 0), group, port); }
+  void stop();
+  int fd() { return sock; } //for poll() in the main loop
+
+  int parsePacket();
+  int available() { return len - readPos; }
+  int read(unsigned char* buf, size_t n);
+  int read(char* buf, size_t n) { return read((unsigned char*)buf, n); }
+  void flush() {}
+  IPAddress remoteIP() { return remote; }
+  uint16_t remotePort() { return remotePortNum; }
+
+  int beginPacket(IPAddress ip, uint16_t port);
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t n) override { outgoing.append((const char*)buf, n); return n; }
+  int endPacket();
+
+private:
+  int sock = -1;
+  char packet[1500];
+  int len = 0, readPos = 0;
+  IPAddress remote, destination;
+  uint16_t remotePortNum = 0, destinationPort = 0;
+  std::string outgoing;
+};
+
+#endif
@@ -0,0 +1,25 @@
+//Arduino core functions for the POSIX backend: the real clock and the system's free memory.
+//Unlike the host tests' core, allocations are not counted and there is no simulated time
+#include "Arduino.h"
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+HostSerial Serial;
+EspClass ESP;
+
+static const auto startTime = std::chrono::steady_clock::now();
+
+unsigned long millis() { return micros() / 1000; }
+unsigned long micros()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+void yield() {}
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+uint32_t EspClass::getFreeHeap()
+{
+  uint64_t free = (uint64_t)sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE);
+  return free > UINT32_MAX ? UINT32_MAX : free;
+}
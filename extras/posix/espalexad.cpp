@@ -0,0 +1,143 @@
+//Espalexa as a Hue bridge emulator daemon on Linux, on the POSIX backend in this directory.
+//Each change by Alexa is printed to stdout as a line "<id> <name> <on|off> <brightness> <hue> <sat> <ct>", id counts over all bridges from 1.
+//Devices beyond 100 go to further linked bridges on the following ports, so hundreds of devices can be served.
+//With -a, the bridges are on consecutive addresses from address instead, all on port, e.g. 127.0.0.1 (any 127.x address is loopback)
+//or aliases added to the interface. Some Echo models only talk to bridges on port 80.
+//  espalexad [-i interface] [-a address] [-p port] [-n count] [type:name]...
+//  type is one of onoff, dimmable, whitespectrum, color, extendedcolor. -n adds count dimmable lights named "Light <n>"
+#include <Espalexa.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <vector>
+
+struct DaemonConfig : EspalexaDefaultConfig {
+  static const uint8_t maxDevices = 100;
+  static const uint8_t httpMaxClients = 64; //requests served per loop(), they are already read by epoll
+  static const uint16_t httpBudgetMs = 20;
+};
+typedef EspalexaT<DaemonConfig> Bridge;
+
+static volatile sig_atomic_t running = 1;
+static void quit(int) { running = 0; }
+
+static void changed(EspalexaDevice* d)
+{
+  printf("%u %s %s %u %u %u %u\n", d->getGlobalId() + 1, d->getName().c_str(), d->getState() ? "on" : "off",
+    d->getValue(), d->getHue(), d->getSat(), d->getCt());
+  fflush(stdout);
+}
+
+static bool addDevice(Bridge& first, const char* spec)
+{
+  const char* types[] = {"onoff", "dimmable", "whitespectrum", "color", "extendedcolor"};
+  const char* colon = strchr(spec, ':');
+  if (colon == nullptr) return false;
+  for (uint8_t t = 0; t < 5; t++)
+  {
+    if (strncmp(spec, types[t], colon - spec) == 0 && strlen(types[t]) == (size_t)(colon - spec))
+      return first.addDevice(colon + 1, changed, (EspalexaDeviceType)t) != 0;
+  }
+  return false;
+}
+
+int main(int argc, char** argv)
+{
+  const char* iface = nullptr;
+  uint32_t address = 0; //first bridge address in host byte order, 0 for one port per bridge
+  int port = 80, count = 0, opt;
+  struct in_addr a;
+  while ((opt = getopt(argc, argv, "i:a:p:n:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'i': iface = optarg; break;
+      case 'a':
+        if (inet_pton(AF_INET, optarg, &a) != 1)
+        {
+          fprintf(stderr, "bad address %s\n", optarg);
+          return 2;
+        }
+        address = ntohl(a.s_addr);
+        break;
+      case 'p': port = atoi(optarg); break;
+      case 'n': count = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-i interface] [-a address] [-p port] [-n count] [type:name]...\n", argv[0]);
+        return 2;
+    }
+  }
+  if (iface != nullptr && !WiFi.useInterface(iface))
+  {
+    fprintf(stderr, "%s: no IPv4 address\n", iface);
+    return 1;
+  }
+
+  int devices = count + (argc - optind);
+  int bridgeCount = devices > 0 ? (devices + DaemonConfig::maxDevices - 1) / DaemonConfig::maxDevices : 1;
+  if (bridgeCount > 255)
+  {
+    fprintf(stderr, "too many devices\n");
+    return 1;
+  }
+  std::vector<Bridge*> bridges;
+  std::vector<ESP8266WebServer*> servers;
+  for (int b = 0; b < bridgeCount; b++)
+  {
+    Bridge* bridge = new Bridge();
+    IPAddress ip((uint32_t)htonl(address + b));
+    ESP8266WebServer* server = address ? new ESP8266WebServer(ip, port) : new ESP8266WebServer(port + b);
+    //as with any external server, requests Espalexa has no route for are passed on to it
+    server->onNotFound([bridge, server]() {
+      if (!bridge->handleAlexaApiCall(server->uri(), server->arg(0))) server->send(404, "text/plain", "Not found");
+    });
+    const char* headerKeys[] = {"If-None-Match"};
+    server->collectHeaders(headerKeys, 1);
+    //the port is also needed by the first bridge, for the SSDP reply
+    if (address) bridge->setBridge(b, port, ip);
+    else bridge->setBridge(b, port + b);
+    if (b) bridges[0]->linkBridge(bridge);
+    bridges.push_back(bridge);
+    servers.push_back(server);
+  }
+  for (int i = optind; i < argc; i++)
+  {
+    if (!addDevice(*bridges[0], argv[i]))
+    {
+      fprintf(stderr, "bad device %s, expected type:name\n", argv[i]);
+      return 2;
+    }
+  }
+  for (int i = 1; i <= count; i++) bridges[0]->addDevice("Light " + String(i), changed, EspalexaDeviceType::dimmable);
+
+  for (int b = 0; b < bridgeCount; b++)
+  {
+    if (!bridges[b]->begin(servers[b]) || servers[b]->fd() < 0)
+    {
+      fprintf(stderr, "bridge %d did not start\n", b);
+      return 1;
+    }
+  }
+  fprintf(stderr, "espalexad: %d devices on %d bridges at %s port %d\n", devices, bridgeCount,
+    (address ? IPAddress((uint32_t)htonl(address)) : WiFi.localIP()).toString().c_str(), port);
+
+  signal(SIGINT, quit);
+  signal(SIGTERM, quit);
+  //the SSDP socket belongs to the first bridge, which is not reachable from here: waiting is bounded by nextServiceIn()
+  std::vector<struct pollfd> fds(bridgeCount);
+  for (int b = 0; b < bridgeCount; b++) fds[b] = {servers[b]->fd(), POLLIN, 0};
+  while (running)
+  {
+    uint32_t wait = UINT32_MAX;
+    for (int b = 0; b < bridgeCount; b++)
+    {
+      bridges[b]->loop();
+      wait = std::min(wait, servers[b]->pending() ? 0 : bridges[b]->nextServiceIn());
+    }
+    if (wait) ::poll(fds.data(), fds.size(), wait);
+  }
+
+  for (int b = 0; b < bridgeCount; b++) servers[b]->close();
+  return 0;
+}
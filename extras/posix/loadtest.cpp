@@ -0,0 +1,280 @@
+//Load test for espalexad: finds the bridges with an SSDP search, then keeps connections to them busy with light reads,
+//state changes and light lists, one request at a time per connection. Prints requests per second and latency percentiles.
+//  loadtest [-h host] [-p port] [-c connections] [-d seconds] [-m min requests/s]
+//-p is only used if no bridge answers the search, bridges on addresses of their own (espalexad -a) are loaded at those. Exits with 1 on failed requests or less than the minimum rate
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Bridge {
+  struct sockaddr_in addr;
+  std::vector<std::string> lights; //JSON keys
+};
+
+struct Conn {
+  int fd = -1;
+  Bridge* bridge = nullptr;
+  std::string in;
+  Clock::time_point sent;
+  int kind = 0;
+};
+
+static const char* user = "loadtest";
+static struct sockaddr_in target;
+
+//length of the complete response at the start of buf and its status, 0 if it is not complete yet
+static size_t responseEnd(const std::string& buf, int& status)
+{
+  size_t headerEnd = buf.find("\r\n\r\n");
+  if (headerEnd == std::string::npos) return 0;
+  status = atoi(buf.c_str() + 9);
+  size_t body = headerEnd + 4;
+  for (size_t p = buf.find("\r\n"); p < headerEnd; p = buf.find("\r\n", p + 2))
+  {
+    if (strncasecmp(buf.c_str() + p + 2, "Content-Length:", 15) == 0)
+    {
+      size_t len = strtoul(buf.c_str() + p + 17, nullptr, 10);
+      return buf.size() >= body + len ? body + len : 0;
+    }
+  }
+  for (size_t p = body; ; ) //chunked
+  {
+    size_t eol = buf.find("\r\n", p);
+    if (eol == std::string::npos) return 0;
+    size_t len = strtoul(buf.c_str() + p, nullptr, 16);
+    if (buf.size() < eol + 2 + len + 2) return 0;
+    p = eol + 2 + len + 2;
+    if (len == 0) return p;
+  }
+}
+
+static int connectTo(const struct sockaddr_in& addr, bool blocking)
+{
+  int fd = socket(AF_INET, SOCK_STREAM | (blocking ? 0 : SOCK_NONBLOCK), 0);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 && errno != EINPROGRESS)
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+//one blocking request, returns the body
+static std::string fetch(const struct sockaddr_in& addr, const std::string& path)
+{
+  int fd = connectTo(addr, true);
+  if (fd < 0) return "";
+  std::string req = "GET " + path + " HTTP/1.1\r\nHost: bridge\r\nConnection: close\r\n\r\n";
+  send(fd, req.data(), req.size(), MSG_NOSIGNAL);
+  std::string buf;
+  char tmp[4096];
+  ssize_t n;
+  int status;
+  while ((n = recv(fd, tmp, sizeof(tmp), 0)) > 0) buf.append(tmp, n);
+  close(fd);
+  size_t end = responseEnd(buf, status);
+  if (end == 0 || status != 200) return "";
+  std::string body = buf.substr(buf.find("\r\n\r\n") + 4);
+  if (buf.find("Transfer-Encoding: chunked") == std::string::npos) return body;
+  std::string joined;
+  for (size_t p = 0; ; )
+  {
+    size_t eol = body.find("\r\n", p);
+    size_t len = strtoul(body.c_str() + p, nullptr, 16);
+    if (len == 0) return joined;
+    joined += body.substr(eol + 2, len);
+    p = eol + 2 + len + 2;
+  }
+}
+
+//SSDP search sent to the host, returns the address and port in the LOCATION of each reply
+static std::vector<struct sockaddr_in> search()
+{
+  std::vector<struct sockaddr_in> found;
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr = target;
+  addr.sin_port = htons(1900);
+  const char* msg = "M-SEARCH * HTTP/1.1\r\nHOST: 239.255.255.250:1900\r\nMAN: \"ssdp:discover\"\r\nMX: 1\r\nST: urn:schemas-upnp-org:device:basic:1\r\n\r\n";
+  sendto(fd, msg, strlen(msg), 0, (struct sockaddr*)&addr, sizeof(addr));
+  struct pollfd p = {fd, POLLIN, 0};
+  while (::poll(&p, 1, 500) > 0) //the daemon answers within its idle interval
+  {
+    char buf[1500];
+    ssize_t n = recv(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) break;
+    buf[n] = 0;
+    const char* loc = strstr(buf, "LOCATION: http://");
+    const char* colon = loc ? strchr(loc + 17, ':') : nullptr;
+    if (colon == nullptr) continue;
+    struct sockaddr_in bridge = target;
+    std::string host(loc + 17, colon - loc - 17);
+    if (inet_pton(AF_INET, host.c_str(), &bridge.sin_addr) != 1) continue;
+    bridge.sin_port = htons(atoi(colon + 1));
+    found.push_back(bridge);
+  }
+  close(fd);
+  return found;
+}
+
+static void sendNext(Conn& c, uint32_t n)
+{
+  const std::string& key = c.bridge->lights[n % c.bridge->lights.size()];
+  std::string req;
+  c.kind = n % 10;
+  if (c.kind < 6) //read one light, as Alexa does after each change
+  {
+    req = "GET /api/" + std::string(user) + "/lights/" + key + " HTTP/1.1\r\nHost: bridge\r\n\r\n";
+  }
+  else if (c.kind < 9)
+  {
+    std::string body = "{\"on\":true,\"bri\":" + std::to_string(n % 254 + 1) + "}";
+    req = "PUT /api/" + std::string(user) + "/lights/" + key + "/state HTTP/1.1\r\nHost: bridge\r\nContent-Type: application/json\r\nContent-Length: " +
+      std::to_string(body.size()) + "\r\n\r\n" + body;
+  }
+  else
+  {
+    req = "GET /api/" + std::string(user) + "/lights HTTP/1.1\r\nHost: bridge\r\n\r\n";
+  }
+  c.sent = Clock::now();
+  send(c.fd, req.data(), req.size(), MSG_NOSIGNAL);
+}
+
+int main(int argc, char** argv)
+{
+  const char* host = "127.0.0.1";
+  int port = 80, connections = 32, opt;
+  double seconds = 5, minRate = 0;
+  while ((opt = getopt(argc, argv, "h:p:c:d:m:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'h': host = optarg; break;
+      case 'p': port = atoi(optarg); break;
+      case 'c': connections = atoi(optarg); break;
+      case 'd': seconds = atof(optarg); break;
+      case 'm': minRate = atof(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-h host] [-p port] [-c connections] [-d seconds] [-m min requests/s]\n", argv[0]);
+        return 2;
+    }
+  }
+  target.sin_family = AF_INET;
+  if (inet_pton(AF_INET, host, &target.sin_addr) != 1)
+  {
+    fprintf(stderr, "bad host %s\n", host);
+    return 2;
+  }
+
+  std::vector<struct sockaddr_in> found = search();
+  printf("loadtest: %u bridges answered the SSDP search\n", (unsigned)found.size());
+  if (found.empty())
+  {
+    found.push_back(target);
+    found[0].sin_port = htons(port);
+  }
+  std::vector<Bridge> bridges;
+  for (auto& addr : found)
+  {
+    Bridge b;
+    b.addr = addr;
+    std::string lights = fetch(addr, "/api/" + std::string(user) + "/lights");
+    for (size_t q = lights.find("\":{\"state\""); q != std::string::npos; q = lights.find("\":{\"state\"", q + 1))
+    {
+      size_t start = lights.rfind('"', q - 1) + 1;
+      b.lights.push_back(lights.substr(start, q - start));
+    }
+    if (!b.lights.empty()) bridges.push_back(b);
+  }
+  size_t lightCount = 0;
+  for (auto& b : bridges) lightCount += b.lights.size();
+  if (lightCount == 0)
+  {
+    fprintf(stderr, "loadtest: no lights found at %s\n", host);
+    return 1;
+  }
+
+  int epoll = epoll_create1(0);
+  std::vector<Conn> conns(connections);
+  for (int i = 0; i < connections; i++)
+  {
+    Conn& c = conns[i];
+    c.bridge = &bridges[i % bridges.size()];
+    c.fd = connectTo(c.bridge->addr, false);
+    if (c.fd < 0)
+    {
+      perror("connect");
+      return 1;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLOUT;
+    ev.data.u32 = i;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, c.fd, &ev);
+  }
+
+  std::vector<double> latencyUs;
+  latencyUs.reserve(1 << 20);
+  uint32_t failed = 0, next = 0;
+  uint32_t perKind[3] = {};
+  Clock::time_point start = Clock::now(), end = start + std::chrono::microseconds((long long)(seconds * 1e6));
+  while (Clock::now() < end)
+  {
+    struct epoll_event ev[64];
+    int n = epoll_wait(epoll, ev, 64, 100);
+    for (int i = 0; i < n; i++)
+    {
+      Conn& c = conns[ev[i].data.u32];
+      if (ev[i].events & EPOLLOUT) //connected
+      {
+        struct epoll_event in = {};
+        in.events = EPOLLIN;
+        in.data.u32 = ev[i].data.u32;
+        epoll_ctl(epoll, EPOLL_CTL_MOD, c.fd, &in);
+        sendNext(c, next++);
+        continue;
+      }
+      char buf[16384];
+      ssize_t r;
+      while ((r = recv(c.fd, buf, sizeof(buf), 0)) > 0) c.in.append(buf, r);
+      if (r == 0)
+      {
+        fprintf(stderr, "loadtest: connection closed by the bridge\n");
+        return 1;
+      }
+      int status;
+      size_t len = responseEnd(c.in, status);
+      if (len == 0) continue;
+      latencyUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - c.sent).count());
+      if (status != 200) failed++;
+      perKind[c.kind < 6 ? 0 : c.kind < 9 ? 1 : 2]++;
+      c.in.erase(0, len);
+      sendNext(c, next++);
+    }
+  }
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::sort(latencyUs.begin(), latencyUs.end());
+  auto pct = [&](double p) { return latencyUs.empty() ? 0 : latencyUs[(size_t)(p / 100 * (latencyUs.size() - 1))]; };
+  double rate = latencyUs.size() / elapsed;
+  printf("loadtest: %u lights on %u bridges, %d connections, %.1f s\n", (unsigned)lightCount, (unsigned)bridges.size(), connections, elapsed);
+  printf("loadtest: %u requests (%u light reads, %u state changes, %u light lists), %u failed\n",
+    (unsigned)latencyUs.size(), perKind[0], perKind[1], perKind[2], failed);
+  printf("loadtest: %.0f requests/s, latency p50 %.0f us, p99 %.0f us, max %.0f us\n", rate, pct(50), pct(99), pct(100));
+  return failed || rate < minRate ? 1 : 0;
+}
@@ -0,0 +1,479 @@
+//POSIX implementations of the WiFi, UDP and web server classes declared in this directory
+#include "ESP8266WiFi.h"
+#include "WiFiUdp.h"
+#include "ESP8266WebServer.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+bool WiFiClass::useInterface(const char* name)
+{
+  struct ifaddrs* list;
+  if (getifaddrs(&list) != 0) return false;
+  bool found = false;
+  for (struct ifaddrs* a = list; a != nullptr; a = a->ifa_next)
+  {
+    if (a->ifa_addr == nullptr || a->ifa_addr->sa_family != AF_INET || strcmp(a->ifa_name, name) != 0) continue;
+    ip = IPAddress((uint32_t)((struct sockaddr_in*)a->ifa_addr)->sin_addr.s_addr);
+    found = true;
+    break;
+  }
+  freeifaddrs(list);
+
+  struct ifreq req = {};
+  strncpy(req.ifr_name, name, IFNAMSIZ - 1);
+  int s = socket(AF_INET, SOCK_DGRAM, 0);
+  if (s >= 0 && ioctl(s, SIOCGIFHWADDR, &req) == 0)
+  {
+    const uint8_t* hw = (const uint8_t*)req.ifr_hwaddr.sa_data;
+    bool zero = true;
+    for (int i = 0; i < 6; i++) if (hw[i]) zero = false;
+    if (!zero) memcpy(mac, hw, 6);
+  }
+  if (s >= 0) ::close(s);
+  return found;
+}
+
+//TCP client
+
+void WiFiClient::Connection::flush()
+{
+  while (!out.empty() && fd >= 0)
+  {
+    ssize_t n = ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+    if (n > 0)
+    {
+      out.erase(0, n);
+      lastActive = millis();
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      if (!waitingForWrite) //the server sends the rest when the socket is writable
+      {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.fd = fd;
+        epoll_ctl(epoll, EPOLL_CTL_MOD, fd, &ev);
+        waitingForWrite = true;
+      }
+      return;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    close();
+    return;
+  }
+  if (fd < 0) return;
+  if (waitingForWrite)
+  {
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epoll, EPOLL_CTL_MOD, fd, &ev);
+    waitingForWrite = false;
+  }
+  if (closeAfterWrite) close();
+}
+
+void WiFiClient::Connection::close()
+{
+  if (fd >= 0) ::close(fd); //also removes it from the epoll set
+  fd = -1;
+  connected = false;
+  in.clear();
+  out.clear();
+}
+
+void WiFiClient::setNoDelay(bool n)
+{
+  int v = n;
+  if (connected()) setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v));
+}
+
+//UDP
+
+uint8_t WiFiUDP::beginMulticast(IPAddress iface, IPAddress group, uint16_t port)
+{
+  stop();
+  sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (sock < 0) return 0;
+  int one = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)); //other SSDP listeners on this machine
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+  {
+    perror("WiFiUDP bind");
+    stop();
+    return 0;
+  }
+  //without a multicast route (e.g. only loopback) the group can't be joined, searches sent to the port itself are still answered
+  struct ip_mreq mreq = {};
+  mreq.imr_multiaddr.s_addr = (uint32_t)group;
+  mreq.imr_interface.s_addr = (uint32_t)iface;
+  if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) perror("WiFiUDP multicast membership");
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &mreq.imr_interface, sizeof(mreq.imr_interface));
+  return 1;
+}
+
+void WiFiUDP::stop()
+{
+  if (sock >= 0) ::close(sock);
+  sock = -1;
+}
+
+int WiFiUDP::parsePacket()
+{
+  len = readPos = 0;
+  if (sock < 0) return 0;
+  struct sockaddr_in from;
+  socklen_t fromLen = sizeof(from);
+  ssize_t n = recvfrom(sock, packet, sizeof(packet), 0, (struct sockaddr*)&from, &fromLen);
+  if (n <= 0) return 0;
+  len = n;
+  remote = IPAddress((uint32_t)from.sin_addr.s_addr);
+  remotePortNum = ntohs(from.sin_port);
+  return len;
+}
+
+int WiFiUDP::read(unsigned char* buf, size_t n)
+{
+  if (n > (size_t)(len - readPos)) n = len - readPos;
+  memcpy(buf, packet + readPos, n);
+  readPos += n;
+  return n;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+  destination = ip;
+  destinationPort = port;
+  outgoing.clear();
+  return 1;
+}
+
+int WiFiUDP::endPacket()
+{
+  if (sock < 0) return 0;
+  struct sockaddr_in to = {};
+  to.sin_family = AF_INET;
+  to.sin_port = htons(destinationPort);
+  to.sin_addr.s_addr = (uint32_t)destination;
+  return sendto(sock, outgoing.data(), outgoing.size(), 0, (struct sockaddr*)&to, sizeof(to)) == (ssize_t)outgoing.size();
+}
+
+//web server
+
+static const char* reason(int code)
+{
+  switch (code)
+  {
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default:  return "";
+  }
+}
+
+void ESP8266WebServer::begin()
+{
+  if (listener >= 0) return;
+  listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int one = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = (uint32_t)address; //INADDR_ANY if not set
+  if (listener < 0 || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, SOMAXCONN) != 0)
+  {
+    fprintf(stderr, "ESP8266WebServer: cannot listen on %s port %d: %s\n", address.toString().c_str(), port, strerror(errno));
+    close();
+    return;
+  }
+  epoll = epoll_create1(0);
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.fd = listener;
+  epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &ev);
+}
+
+void ESP8266WebServer::close()
+{
+  for (auto& c : conns) c.second->close();
+  conns.clear();
+  ready.clear();
+  if (listener >= 0) ::close(listener);
+  if (epoll >= 0) ::close(epoll);
+  listener = epoll = -1;
+}
+
+void ESP8266WebServer::accept()
+{
+  for (;;)
+  {
+    int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+    if (fd < 0) return;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); //small responses on kept-alive connections
+    auto c = std::make_shared<WiFiClient::Connection>();
+    c->fd = fd;
+    c->epoll = epoll;
+    c->lastActive = millis();
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev);
+    conns[fd] = c; //replaces a connection closed by its WiFiClient, whose fd was reused
+  }
+}
+
+void ESP8266WebServer::drop(int fd)
+{
+  auto it = conns.find(fd);
+  if (it == conns.end()) return;
+  it->second->close();
+  conns.erase(it);
+}
+
+void ESP8266WebServer::receive(std::shared_ptr<WiFiClient::Connection> c)
+{
+  char buf[4096];
+  for (;;)
+  {
+    ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+    if (n > 0)
+    {
+      c->in.append(buf, n);
+      c->lastActive = millis();
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (n < 0 && errno == EINTR) continue;
+    drop(c->fd); //closed by the peer
+    return;
+  }
+  size_t headerEnd, bodyLen;
+  if (complete(c->in, headerEnd, bodyLen))
+  {
+    if (!c->ready) ready.push_back(c);
+    c->ready = true;
+  }
+  else if (c->in.size() > requestLimit) drop(c->fd);
+}
+
+void ESP8266WebServer::poll()
+{
+  struct epoll_event ev[64];
+  int n = epoll_wait(epoll, ev, 64, 0);
+  for (int i = 0; i < n; i++)
+  {
+    int fd = ev[i].data.fd;
+    if (fd == listener)
+    {
+      accept();
+      continue;
+    }
+    auto it = conns.find(fd);
+    if (it == conns.end()) continue;
+    std::shared_ptr<WiFiClient::Connection> c = it->second;
+    if (ev[i].events & EPOLLOUT) c->flush();
+    if (ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) receive(c);
+    if (!c->connected) conns.erase(fd);
+  }
+  if (idleTimeout && millis() - lastSweep >= 1000) sweep();
+}
+
+//closes connections without traffic for idleTimeout, incl. those whose peer stopped reading.
+//A connection also held by a WiFiClient outside the server, like an event subscriber, stays open
+void ESP8266WebServer::sweep()
+{
+  lastSweep = millis();
+  for (auto it = conns.begin(); it != conns.end(); )
+  {
+    std::shared_ptr<WiFiClient::Connection>& c = it->second;
+    long held = 1 + (currentClient.conn == c);
+    if (!c->ready && c.use_count() == held && lastSweep - c->lastActive >= idleTimeout)
+    {
+      c->close();
+      it = conns.erase(it);
+    }
+    else it++;
+  }
+}
+
+bool ESP8266WebServer::complete(const std::string& in, size_t& headerEnd, size_t& bodyLen)
+{
+  headerEnd = in.find("\r\n\r\n");
+  if (headerEnd == std::string::npos) return false;
+  bodyLen = 0;
+  for (size_t p = in.find("\r\n"); p < headerEnd; p = in.find("\r\n", p + 2))
+  {
+    if (strncasecmp(in.c_str() + p + 2, "Content-Length:", 15) == 0)
+    {
+      bodyLen = strtoul(in.c_str() + p + 17, nullptr, 10);
+      break;
+    }
+  }
+  return in.size() >= headerEnd + 4 + bodyLen;
+}
+
+void ESP8266WebServer::parse(WiFiClient::Connection& c)
+{
+  size_t headerEnd, bodyLen;
+  complete(c.in, headerEnd, bodyLen);
+  cur = Request();
+  size_t lineEnd = c.in.find("\r\n");
+  std::string line = c.in.substr(0, lineEnd);
+  size_t sp1 = line.find(' '), sp2 = line.rfind(' ');
+  std::string m = line.substr(0, sp1);
+  const char* names[] = {"", "GET", "HEAD", "POST", "PUT", "PATCH", "DELETE", "OPTIONS"};
+  for (int i = 1; i < 8; i++) if (m == names[i]) cur.method = (HTTPMethod)i;
+  if (sp1 != std::string::npos && sp2 > sp1) cur.uri = line.substr(sp1 + 1, sp2 - sp1 - 1);
+  cur.http11 = sp2 != std::string::npos && line.compare(sp2 + 1, std::string::npos, "HTTP/1.0") != 0;
+  cur.keepAlive = cur.http11;
+  for (size_t p = lineEnd; p < headerEnd; )
+  {
+    size_t next = c.in.find("\r\n", p + 2);
+    size_t colon = c.in.find(':', p + 2);
+    if (colon < next)
+    {
+      std::string name = c.in.substr(p + 2, colon - p - 2);
+      size_t v = c.in.find_first_not_of(' ', colon + 1);
+      std::string value = v < next ? c.in.substr(v, next - v) : "";
+      if (strcasecmp(name.c_str(), "Connection") == 0) cur.keepAlive = strcasecmp(value.c_str(), "close") != 0 && (cur.http11 || strcasecmp(value.c_str(), "keep-alive") == 0);
+      cur.headers.push_back({name, value});
+    }
+    p = next;
+  }
+  cur.body = c.in.substr(headerEnd + 4, bodyLen);
+  c.in.erase(0, headerEnd + 4 + bodyLen);
+}
+
+void ESP8266WebServer::handleClient()
+{
+  if (listener < 0) return;
+  if (ready.empty()) poll();
+  std::shared_ptr<WiFiClient::Connection> c;
+  while (!ready.empty() && c == nullptr)
+  {
+    c = ready.front();
+    ready.pop_front();
+    c->ready = false;
+    if (!c->connected) c = nullptr;
+  }
+  if (c == nullptr) return;
+
+  int fd = c->fd;
+  parse(*c);
+  currentClient = WiFiClient(c);
+  dispatch();
+  if (!cur.keepAlive) c->closeAfterWrite = true;
+  c->flush();
+  if (!c->connected)
+  {
+    auto it = conns.find(fd);
+    if (it != conns.end() && it->second == c) conns.erase(it);
+    return;
+  }
+  size_t headerEnd, bodyLen;
+  if (complete(c->in, headerEnd, bodyLen)) //pipelined request
+  {
+    ready.push_back(c);
+    c->ready = true;
+  }
+}
+
+void ESP8266WebServer::dispatch()
+{
+  chunked = false;
+  contentLength = 0;
+  pendingHeaders.clear();
+  std::string path = cur.uri.substr(0, cur.uri.find('?'));
+  for (auto& route : routes)
+  {
+    if (route.uri == path && (route.method == HTTP_ANY || route.method == cur.method))
+    {
+      route.fn();
+      return;
+    }
+  }
+  if (notFound) notFound();
+  else send(404, "text/plain", "Not found");
+}
+
+void ESP8266WebServer::sendHeader(const String& name, const String& value, bool first)
+{
+  std::string h = std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+  if (first) pendingHeaders.insert(0, h);
+  else pendingHeaders += h;
+}
+
+void ESP8266WebServer::send(int code, const char* type, const String& content)
+{
+  WiFiClient::Connection* c = currentClient.conn.get();
+  if (c == nullptr || !c->connected) return;
+  char line[64];
+  sprintf(line, "HTTP/1.1 %d %s\r\n", code, reason(code));
+  c->out += line;
+  if (type && *type) c->out += std::string("Content-Type: ") + type + "\r\n";
+  if (contentLength == CONTENT_LENGTH_UNKNOWN)
+  {
+    if (cur.http11) //HTTP/1.0 has no chunks, the response ends when the connection is closed
+    {
+      chunked = true;
+      c->out += "Transfer-Encoding: chunked\r\n";
+    }
+    else cur.keepAlive = false;
+  } else {
+    c->out += "Content-Length: " + std::to_string(contentLength ? contentLength : content.length()) + "\r\n";
+  }
+  c->out += pendingHeaders;
+  pendingHeaders.clear();
+  c->out += cur.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+  if (content.length()) sendContent(content);
+  contentLength = 0;
+}
+
+void ESP8266WebServer::sendContent(const char* s, size_t len)
+{
+  WiFiClient::Connection* c = currentClient.conn.get();
+  if (c == nullptr || !c->connected) return;
+  if (!chunked)
+  {
+    c->out.append(s, len);
+    return;
+  }
+  char size[20];
+  sprintf(size, "%zx\r\n", len);
+  c->out += size;
+  c->out.append(s, len);
+  c->out += "\r\n";
+  if (len == 0) chunked = false; //last chunk
+}
+
+String ESP8266WebServer::header(const String& name)
+{
+  bool wanted = false;
+  for (auto& k : collected) if (strcasecmp(k.c_str(), name.c_str()) == 0) wanted = true;
+  if (!wanted) return String(); //like the ESP8266 server, only headers passed to collectHeaders() are kept
+  for (auto& h : cur.headers) if (strcasecmp(h.first.c_str(), name.c_str()) == 0) return String(h.second.c_str());
+  return String();
+}
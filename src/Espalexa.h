@@ -19,6 +19,7 @@
 #include "Arduino.h"
 
 //you can use these defines for library config in your sketch. Just use them before #include <Espalexa.h>
+//except for ESPALEXA_ASYNC, they set the defaults of EspalexaDefaultConfig below, which can also be replaced per instance
 //#define ESPALEXA_ASYNC
 
 //in case this is unwanted in your application (will disable the /espalexa value page)
@@ -30,6 +31,47 @@
 
 //#define ESPALEXA_DEBUG
 
+//max. time in ms the sketch may wait between loop() calls when Espalexa is idle, see nextServiceIn()
+#ifndef ESPALEXA_IDLE_INTERVAL
+ #define ESPALEXA_IDLE_INTERVAL 100
+#endif
+//max. wait in ms while a client keeps its connection open without sending, or an event subscriber cannot take data
+#ifndef ESPALEXA_WAIT_INTERVAL
+ #define ESPALEXA_WAIT_INTERVAL 10
+#endif
+
+//print all HTTP API requests and SSDP datagrams Espalexa receives in a replayable capture format (opt-in)
+//#define ESPALEXA_RECORD
+#ifndef ESPALEXA_RECORD_STREAM
+ #define ESPALEXA_RECORD_STREAM Serial
+#endif
+
+//count requests and track the peak heap use per request type and loop() iteration (opt-in)
+//#define ESPALEXA_HEAP_STATS
+
+//record timestamped events of request handling into a ring buffer, served as Chrome trace JSON at /espalexa/trace (opt-in)
+//#define ESPALEXA_TRACE
+#ifndef ESPALEXA_TRACE_SIZE
+ #define ESPALEXA_TRACE_SIZE 64 //number of events kept
+#endif
+
+//server-sent events of device changes at /espalexa/events (opt-in)
+//#define ESPALEXA_EVENTS
+#ifndef ESPALEXA_EVENT_QUEUE
+ #define ESPALEXA_EVENT_QUEUE 8 //events kept for slow subscribers, older ones are dropped
+#endif
+#ifndef ESPALEXA_EVENT_CLIENTS
+ #define ESPALEXA_EVENT_CLIENTS 4 //max. subscribers (sync server only, the async server manages its own)
+#endif
+
+//sync server only: serve up to this many HTTP clients (or keep-alive requests) per loop() call, within a time budget in ms
+#ifndef ESPALEXA_HTTP_MAX_CLIENTS
+ #define ESPALEXA_HTTP_MAX_CLIENTS 1 //default is to serve a single client per loop()
+#endif
+#ifndef ESPALEXA_HTTP_BUDGET_MS
+ #define ESPALEXA_HTTP_BUDGET_MS 20
+#endif
+
 #ifdef ESPALEXA_ASYNC
  #ifdef ARDUINO_ARCH_ESP32
   #include <AsyncTCP.h>
@@ -37,6 +79,7 @@
   #include <ESPAsyncTCP.h>
  #endif
  #include <ESPAsyncWebServer.h>
+ #include <memory>
 #else
  #ifdef ARDUINO_ARCH_ESP32
   #include <WiFi.h>
@@ -50,40 +93,170 @@
 
 #ifdef ESPALEXA_DEBUG
  #pragma message "Espalexa 2.7.0 debug mode"
- #define EA_DEBUG(x)  Serial.print (x)
- #define EA_DEBUGLN(x) Serial.println (x)
-#else
- #define EA_DEBUG(x)
- #define EA_DEBUGLN(x)
 #endif
+//the helper macros below are only used inside EspalexaT, the compiler drops them for disabled Config options
+#define EA_DEBUG(x)  do { if (Config::debug) Serial.print (x); } while (0)
+#define EA_DEBUGLN(x) do { if (Config::debug) Serial.println (x); } while (0)
 
 #include "EspalexaDevice.h"
 
+#define EA_HEAP_BEGIN(t) do { if (Config::heapStats) heapRequestBegin(EspalexaRequestType::t); } while (0)
+#define EA_HEAP_TYPE(t) do { if (Config::heapStats) heapReqType = EspalexaRequestType::t; } while (0)
+#define EA_HEAP_SAMPLE() do { if (Config::heapStats) heapSample(); } while (0)
+
 #define DEVICE_UNIQUE_ID_LENGTH 12
+#define ESPALEXA_EVENT_MAXLEN 256 //longest server-sent event incl. terminator
+
+#define EA_TRACE(p, ph) do { if (Config::trace) trace(EspalexaTracePoint::p, ph); } while (0)
+
+//with the async server on ESP32, events are queued by the async_tcp task and sent from loop()
+#if defined(ESPALEXA_ASYNC) && defined(ARDUINO_ARCH_ESP32)
+ #define EA_EVENT_LOCK() portENTER_CRITICAL(&eventMux)
+ #define EA_EVENT_UNLOCK() portEXIT_CRITICAL(&eventMux)
+#else
+ #define EA_EVENT_LOCK()
+ #define EA_EVENT_UNLOCK()
+#endif
+
+enum class EspalexaTracePoint : uint8_t { http = 0, udp, request, state, callback, send };
+
+struct EspalexaTraceEvent {
+  uint32_t ts;           //micros()
+  EspalexaTracePoint point;
+  char ph;               //Chrome trace phase: 'B' begin, 'E' end, 'i' instant
+};
+
+enum class EspalexaRequestType : uint8_t { description = 0, page, username, state, light, lights, config, fullstate, other, ssdp, loop, count };
+
+struct EspalexaHeapStats {
+  uint32_t requests = 0;       //number of handled requests
+  uint32_t heapUsed = 0;       //sum of the peak heap use of all requests in bytes
+  uint32_t peakHeapUsed = 0;   //largest peak heap use of a single request in bytes
+  uint32_t budget = 0;         //heap use allowed per request, 0 for no limit
+  uint32_t overBudget = 0;     //number of requests that used more heap than budget
+};
 
-class Espalexa {
+//snapshot of a device state change, queued for /espalexa/events subscribers
+struct EspalexaEvent {
+  float x, y;
+  uint16_t hue, ct;
+  uint8_t idx, val, sat;
+  EspalexaDeviceProperty changed;
+  EspalexaColorMode mode;
+};
+#define ESPALEXA_JSON_DEVICE_MAXLEN 512 //longest device JSON string incl. terminator, device names are cut to ESPALEXA_NAME_MAXLEN
+#define ESPALEXA_STATE_VERSION 2 //binary state format written by exportState()
+#define ESPALEXA_STATE_HEADLEN 16 //"ES", format version, record count, state version, since, boot id (u32 each)
+
+//compile-time configuration, derive from this to change single options:
+//struct MyConfig : EspalexaDefaultConfig { static const uint8_t maxDevices = 2; static const bool events = true; };
+//EspalexaT<MyConfig> espalexa;
+//The defaults follow the ESPALEXA_* defines above. Code of disabled options is dropped by the compiler, their buffers shrink to one entry
+struct EspalexaDefaultConfig {
+  static const uint8_t maxDevices = ESPALEXA_MAXDEVICES; //size of the device table
+  #ifdef ESPALEXA_NO_SUBPAGE
+  static const bool statusPage = false;
+  #else
+  static const bool statusPage = true; //serve the /espalexa value page
+  #endif
+  static const bool colorSupport = true; //false to expose all devices as on/off or dimmable lights and drop color handling
+  #ifdef ESPALEXA_DEBUG
+  static const bool debug = true;
+  #else
+  static const bool debug = false; //print debug messages to Serial
+  #endif
+  #ifdef ESPALEXA_RECORD
+  static const bool record = true;
+  #else
+  static const bool record = false; //print received requests and SSDP datagrams to recordStream() in capture format
+  #endif
+  static Print& recordStream() { return ESPALEXA_RECORD_STREAM; }
+  #ifdef ESPALEXA_HEAP_STATS
+  static const bool heapStats = true;
+  #else
+  static const bool heapStats = false; //heap use statistics per request type
+  #endif
+  #ifdef ESPALEXA_TRACE
+  static const bool trace = true;
+  #else
+  static const bool trace = false; //Chrome trace of request handling at /espalexa/trace
+  #endif
+  static const uint16_t traceSize = ESPALEXA_TRACE_SIZE;
+  #ifdef ESPALEXA_EVENTS
+  static const bool events = true;
+  #else
+  static const bool events = false; //server-sent events of device changes at /espalexa/events
+  #endif
+  static const uint8_t eventQueue = ESPALEXA_EVENT_QUEUE;
+  static const uint8_t eventClients = ESPALEXA_EVENT_CLIENTS;
+  static const uint8_t httpMaxClients = ESPALEXA_HTTP_MAX_CLIENTS; //sync server: clients served per loop()
+  static const uint16_t httpBudgetMs = ESPALEXA_HTTP_BUDGET_MS;
+  static const uint16_t idleInterval = ESPALEXA_IDLE_INTERVAL; //see nextServiceIn()
+  static const uint16_t waitInterval = ESPALEXA_WAIT_INTERVAL;
+};
+
+template <class Config = EspalexaDefaultConfig>
+class EspalexaT {
 private:
   //private member vars
   #ifdef ESPALEXA_ASYNC
   AsyncWebServer* serverAsync;
   AsyncWebServerRequest* server; //this saves many #defines
+  AsyncResponseStream* jsonStream = nullptr;
+  char pendingEtag[32] = ""; //ETag for the next response
   String body = "";
   #elif defined ARDUINO_ARCH_ESP32
   WebServer* server;
   #else
   ESP8266WebServer* server;
   #endif
-  uint8_t currentDeviceCount = 0;
+  uint8_t currentDeviceCount = 0; //number of slots up to the last used one, removed devices leave empty slots
+  uint8_t slotsUsed = 0; //number of slots that ever held a device
   bool discoverable = true;
   bool udpConnected = false;
+  uint8_t bridgeIndex = 0; //identity of this bridge if several run on one ESP
+  uint16_t idBase = 0; //slots of the linked bridges before this one, added to the ids of its devices
+  uint16_t httpPort = 80;
+  IPAddress bridgeIP; //address advertised for this bridge, WiFi.localIP() if not set
+  EspalexaT* nextBridge = nullptr; //linked bridges share the SSDP socket of the first one and take devices it has no room for
+  EspalexaT* udpBridge = this; //bridge owning the SSDP socket
+  bool loopBusy = false; //last loop() iteration did work, more may be queued
+  bool loopWaiting = false; //an open connection or event subscriber may need service soon, but there is nothing to do yet
+  bool httpServed = false; //a request handler ran, set by the handlers because the server does not tell
 
-  EspalexaDevice* devices[ESPALEXA_MAXDEVICES] = {};
+  EspalexaDevice* devices[Config::maxDevices] = {};
+  bool deviceOwned[Config::maxDevices] = {}; //device was constructed by Espalexa and is deleted on removal
   //Keep in mind that Device IDs go from 1 to DEVICES, cpp arrays from 0 to DEVICES-1!!
   
   WiFiUDP espalexaUdp;
   IPAddress ipMulti;
   uint32_t mac24; //bottom 24 bits of mac
+  uint32_t bootId = 0; //micros() at begin(), tells state versions of different boots apart
+  bool importSynced = false; //a snapshot was imported, deltas on top of it can be applied
+  uint32_t importBoot = 0; //boot id and state version of the exporting side after the last import
+  uint32_t importVersion = 0;
   String escapedMac=""; //lowercase mac address
+  EspalexaHeapStats heapStats[Config::heapStats ? static_cast<uint8_t>(EspalexaRequestType::count) : 1];
+  EspalexaRequestType heapReqType = EspalexaRequestType::other;
+  bool heapReqOpen = false;
+  uint32_t heapReqStart = 0, heapReqMin = 0;
+  uint32_t heapLoopStart = 0, heapLoopMin = 0;
+  EspalexaTraceEvent traceEvents[Config::trace ? Config::traceSize : 1];
+  uint32_t traceCount = 0;
+  EspalexaEvent events[Config::events ? Config::eventQueue : 1];
+  uint32_t eventCount = 0; //total events queued, the newest is at (eventCount-1) % Config::eventQueue
+  #ifdef ESPALEXA_ASYNC
+  AsyncEventSource* eventSource = nullptr;
+  uint32_t eventCursor = 0;
+  #ifdef ARDUINO_ARCH_ESP32
+  portMUX_TYPE eventMux = portMUX_INITIALIZER_UNLOCKED; //guards events[] and eventCount
+  #endif
+  #else
+  WiFiClient eventClients[Config::events ? Config::eventClients : 1];
+  uint32_t eventCursors[Config::events ? Config::eventClients : 1] = {};
+  bool eventBlocked[Config::events ? Config::eventClients : 1] = {}; //subscriber could not take the next event in the last loop()
+  #endif
+  char lightIdPrefix[18] = ""; //uppercase mac address with colons, start of each light's uniqueid
   
   //private member functions
   const char* modeString(EspalexaColorMode m)
@@ -93,6 +266,20 @@ private:
     return "ct";
   }
   
+  const char* propertyString(EspalexaDeviceProperty p)
+  {
+    switch (p)
+    {
+      case EspalexaDeviceProperty::on:  return "on";
+      case EspalexaDeviceProperty::off: return "off";
+      case EspalexaDeviceProperty::bri: return "bri";
+      case EspalexaDeviceProperty::hs:  return "hs";
+      case EspalexaDeviceProperty::ct:  return "ct";
+      case EspalexaDeviceProperty::xy:  return "xy";
+      default: return "none";
+    }
+  }
+
   const char* typeString(EspalexaDeviceType t)
   {
     switch (t)
@@ -121,17 +308,17 @@ private:
   
   void encodeLightId(uint8_t idx, char* out)
   {
-    uint8_t mac[6];
-    WiFi.macAddress(mac);
-
-    // sprintf_P(out, PSTR("%02X:%02X:%02X:%02X:%02X:%02X:00:11-%02X"), mac[0],mac[1],mac[2],mac[3],mac[4],mac[5], idx);
-    sprintf_P(out, PSTR("%02X:%02X:%02X:%02X:%02X:%02X-%02X-00:11"), mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], idx);
+    //MAC part is cached in begin(), as WiFi.macAddress() is slow
+    out = jsonAppend(out, lightIdPrefix);
+    *out++ = '-';
+    out = jsonAppendHex(out, idx);
+    jsonAppendP(out, PSTR("-00:11"));
   }
 
   // construct 'globally unique' Json dict key fitting into signed int
   inline int encodeLightKey(uint8_t idx)
   {
-    static_assert(ESPALEXA_MAXDEVICES <= 128, "");
+    static_assert(Config::maxDevices <= 128, "");
     return (mac24<<7) | idx;
   }
 
@@ -141,60 +328,624 @@ private:
     return (((uint32_t)key>>7) == mac24) ? (key & 127U) : 255U;
   }
 
-  //device JSON string: color+temperature device emulates LCT015, dimmable device LWB010, (TODO: on/off Plug 01, color temperature device LWT010, color device LST001)
+  //minimal JSON writers, each appends to out and returns the new end of the string
+  static char* jsonAppend(char* out, const char* s)
+  {
+    while (*s) *out++ = *s++;
+    *out = 0;
+    return out;
+  }
+
+  static char* jsonAppendP(char* out, const char* s)
+  {
+    strcpy_P(out, s);
+    return out + strlen(out);
+  }
+
+  static char* jsonAppendUInt(char* out, uint32_t v)
+  {
+    char tmp[10];
+    uint8_t n = 0;
+    do {
+      tmp[n++] = '0' + (v % 10);
+      v /= 10;
+    } while (v);
+    while (n) *out++ = tmp[--n];
+    *out = 0;
+    return out;
+  }
+
+  static char* jsonAppendHex(char* out, uint8_t v)
+  {
+    const char hex[] = "0123456789ABCDEF";
+    *out++ = hex[v >> 4];
+    *out++ = hex[v & 0x0F];
+    *out = 0;
+    return out;
+  }
+
+  //same output as printf %f (6 decimals) for color coordinates, which are clamped to 0-1 (NaN from setColor(0,0,0) or a client gives 0)
+  static char* jsonAppendFloat(char* out, float f)
+  {
+    if (!(f > 0)) f = 0; //also catches NaN
+    if (f > 1) f = 1;
+    uint32_t ip = f;
+    uint32_t frac = (f - ip) * 1000000.0 + 0.5;
+    if (frac >= 1000000) { ip++; frac -= 1000000; }
+    out = jsonAppendUInt(out, ip);
+    *out++ = '.';
+    for (uint32_t d = 100000; d > 0; d /= 10) *out++ = '0' + (frac / d) % 10;
+    *out = 0;
+    return out;
+  }
+
+  //device JSON, specialized per device type at compile time. Emulates on/off HASS321, dimmable LWB010, white spectrum LWT010, color LST001, color+temperature LCT015
+  template <EspalexaDeviceType T>
+  char* deviceJsonT(EspalexaDevice* dev, char* p)
+  {
+    const bool hasBri = (T != EspalexaDeviceType::onoff);
+    const bool hasColor = (T == EspalexaDeviceType::color || T == EspalexaDeviceType::extendedcolor);
+    const bool hasCt = (T == EspalexaDeviceType::whitespectrum || T == EspalexaDeviceType::extendedcolor);
+
+    p = jsonAppendP(p, PSTR("{\"state\":{\"on\":"));
+    p = jsonAppendP(p, dev->getValue() ? PSTR("true") : PSTR("false"));
+    if (hasBri)
+    {
+      p = jsonAppendP(p, PSTR(",\"bri\":"));
+      p = jsonAppendUInt(p, dev->getLastValue()-1);
+    }
+    if (hasColor)
+    {
+      p = jsonAppendP(p, PSTR(",\"hue\":"));
+      p = jsonAppendUInt(p, dev->getHue());
+      p = jsonAppendP(p, PSTR(",\"sat\":"));
+      p = jsonAppendUInt(p, dev->getSat());
+      p = jsonAppendP(p, PSTR(",\"effect\":\"none\",\"xy\":["));
+      p = jsonAppendFloat(p, dev->getX());
+      *p++ = ',';
+      p = jsonAppendFloat(p, dev->getY());
+      *p++ = ']';
+    }
+    if (hasCt)
+    {
+      p = jsonAppendP(p, PSTR(",\"ct\":"));
+      p = jsonAppendUInt(p, dev->getCt());
+    }
+    p = jsonAppendP(p, PSTR(",\"alert\":\"none\""));
+    if (hasColor || hasCt)
+    {
+      p = jsonAppendP(p, PSTR(",\"colormode\":\""));
+      p = jsonAppend(p, modeString(dev->getColorMode()));
+      *p++ = '"';
+    }
+    if (hasBri) p = jsonAppendP(p, PSTR(",\"mode\":\"homeautomation\""));
+    p = jsonAppendP(p, PSTR(",\"reachable\":true},\"type\":\""));
+    p = jsonAppendP(p, typeString(T));
+    p = jsonAppendP(p, PSTR("\",\"name\":\""));
+    p += dev->getName(p, ESPALEXA_NAME_MAXLEN +1);
+    p = jsonAppendP(p, PSTR("\",\"modelid\":\""));
+    p = jsonAppendP(p, modelidString(T));
+    p = jsonAppendP(p, PSTR("\",\"manufacturername\":\"Philips\""));
+    if (hasBri)
+    {
+      p = jsonAppendP(p, PSTR(",\"productname\":\"E"));
+      *p++ = '0' + static_cast<uint8_t>(T);
+      *p++ = '"';
+    }
+    p = jsonAppendP(p, PSTR(",\"uniqueid\":\""));
+    encodeLightId(dev->getId() + 1, p);
+    p += strlen(p);
+    return jsonAppendP(p, PSTR("\",\"swversion\":\"espalexa-2.7.0\"}"));
+  }
+
+  //device JSON string, buf needs to hold at least ESPALEXA_JSON_DEVICE_MAXLEN bytes
   void deviceJsonString(EspalexaDevice* dev, char* buf)
   {
-    char buf_lightid[27];
-    encodeLightId(dev->getId() + 1, buf_lightid);
-    
-    char buf_col[80] = "";
-    //color support
-    if (static_cast<uint8_t>(dev->getType()) > 2)
-      sprintf_P(buf_col,PSTR(",\"hue\":%u,\"sat\":%u,\"effect\":\"none\",\"xy\":[%f,%f]")
-        ,dev->getHue(), dev->getSat(), dev->getX(), dev->getY());
-      
-    char buf_ct[16] = "";
-    //white spectrum support
-    if (static_cast<uint8_t>(dev->getType()) > 1 && dev->getType() != EspalexaDeviceType::color)
-      sprintf(buf_ct, ",\"ct\":%u", dev->getCt());
-    
-    char buf_cm[20] = "";
-    if (static_cast<uint8_t>(dev->getType()) > 1)
-      sprintf(buf_cm,PSTR("\",\"colormode\":\"%s"), modeString(dev->getColorMode()));
-    
+    if (!Config::colorSupport) //color devices appear as dimmable lights
+    {
+      if (dev->getType() == EspalexaDeviceType::onoff) deviceJsonT<EspalexaDeviceType::onoff>(dev, buf);
+      else deviceJsonT<EspalexaDeviceType::dimmable>(dev, buf);
+      return;
+    }
+    switch (dev->getType())
+    {
+      case EspalexaDeviceType::onoff:         deviceJsonT<EspalexaDeviceType::onoff>(dev, buf); break;
+      case EspalexaDeviceType::dimmable:      deviceJsonT<EspalexaDeviceType::dimmable>(dev, buf); break;
+      case EspalexaDeviceType::whitespectrum: deviceJsonT<EspalexaDeviceType::whitespectrum>(dev, buf); break;
+      case EspalexaDeviceType::color:         deviceJsonT<EspalexaDeviceType::color>(dev, buf); break;
+      case EspalexaDeviceType::extendedcolor: deviceJsonT<EspalexaDeviceType::extendedcolor>(dev, buf); break;
+      default: strcpy(buf, "{}");
+    }
+  }
+
+  //remember the new state of a device changed by Alexa, overwrites the oldest event if the queue is full
+  void queueEvent(EspalexaDevice* dev)
+  {
+    EspalexaEvent e;
+    e.idx = dev->getId();
+    e.changed = dev->getLastChangedProperty();
+    e.val = dev->getValue();
+    e.mode = dev->getColorMode();
+    e.hue = dev->getHue();
+    e.sat = dev->getSat();
+    e.ct = dev->getCt();
+    e.x = dev->getX();
+    e.y = dev->getY();
+    EA_EVENT_LOCK();
+    events[eventCount % Config::eventQueue] = e;
+    eventCount++;
+    EA_EVENT_UNLOCK();
+  }
+
+  uint32_t queuedEventCount()
+  {
+    EA_EVENT_LOCK();
+    uint32_t n = eventCount;
+    EA_EVENT_UNLOCK();
+    return n;
+  }
+
+  //copies event n, false if it was overwritten by newer events meanwhile
+  bool eventSnapshot(uint32_t n, EspalexaEvent& e)
+  {
+    EA_EVENT_LOCK();
+    e = events[n % Config::eventQueue];
+    bool lost = eventCount - n > Config::eventQueue;
+    EA_EVENT_UNLOCK();
+    return !lost;
+  }
+
+  //event data JSON, without SSE framing
+  void eventJsonString(const EspalexaEvent& e, char* p)
+  {
+    p = jsonAppendP(p, PSTR("{\"id\":\""));
+    p = jsonAppendUInt(p, encodeLightKey(e.idx));
+    p = jsonAppendP(p, PSTR("\",\"changed\":\""));
+    p = jsonAppend(p, propertyString(e.changed));
+    p = jsonAppendP(p, PSTR("\",\"on\":"));
+    p = jsonAppendP(p, e.val ? PSTR("true") : PSTR("false"));
+    p = jsonAppendP(p, PSTR(",\"bri\":"));
+    p = jsonAppendUInt(p, e.val);
+    p = jsonAppendP(p, PSTR(",\"colormode\":\""));
+    p = jsonAppend(p, modeString(e.mode));
+    p = jsonAppendP(p, PSTR("\",\"hue\":"));
+    p = jsonAppendUInt(p, e.hue);
+    p = jsonAppendP(p, PSTR(",\"sat\":"));
+    p = jsonAppendUInt(p, e.sat);
+    p = jsonAppendP(p, PSTR(",\"ct\":"));
+    p = jsonAppendUInt(p, e.ct);
+    p = jsonAppendP(p, PSTR(",\"xy\":["));
+    p = jsonAppendFloat(p, e.x);
+    *p++ = ',';
+    p = jsonAppendFloat(p, e.y);
+    jsonAppendP(p, PSTR("]}"));
+  }
 
-    if (static_cast<uint8_t>(dev->getType()) == 0)
+  //send queued events to all subscribers, called from loop()
+  void serveEvents()
+  {
+    char buf[ESPALEXA_EVENT_MAXLEN];
+    EspalexaEvent e;
+    uint32_t count = queuedEventCount();
+    #ifdef ESPALEXA_ASYNC
+    if (eventSource == nullptr) return;
+    if (count - eventCursor > Config::eventQueue) eventCursor = count - Config::eventQueue;
+    for (; eventCursor != count; eventCursor++)
     {
-       // On/Off
-        sprintf_P(buf, PSTR("{\"state\":{\"on\":%s,\"alert\":\"none%\",\"reachable\":true},"
-                       "\"type\":\"%s\",\"name\":\"%s\",\"modelid\":\"%s\",\"manufacturername\":\"Philips\",\"uniqueid\":\"%s\",\"swversion\":\"espalexa-2.7.0\"}")
-                      
-        , (dev->getValue())?"true":"false", typeString(dev->getType()),
-        dev->getName().c_str(), modelidString(dev->getType()), buf_lightid);
+      if (!eventSnapshot(eventCursor, e)) continue;
+      eventJsonString(e, buf);
+      eventSource->send(buf, "change", eventCursor +1);
     }
-    else
+    #else
+    for (uint8_t i = 0; i < Config::eventClients; i++)
     {
+      WiFiClient& c = eventClients[i];
+      if (!c || !c.connected()) continue;
+      uint32_t& cursor = eventCursors[i];
+      eventBlocked[i] = false;
+      if (count - cursor > Config::eventQueue) cursor = count - Config::eventQueue; //client too slow, skip lost events
+      for (; cursor != count; cursor++)
+      {
+        eventSnapshot(cursor, e);
+        char* p = jsonAppendP(buf, PSTR("id: "));
+        p = jsonAppendUInt(p, cursor +1);
+        p = jsonAppendP(p, PSTR("\nevent: change\ndata: "));
+        eventJsonString(e, p);
+        p += strlen(p);
+        p = jsonAppendP(p, PSTR("\n\n"));
+        size_t len = p - buf;
+        #ifndef ARDUINO_ARCH_ESP32
+        if (c.availableForWrite() < len) //never block on a slow client, try again soon
+        {
+          eventBlocked[i] = true;
+          loopWaiting = true;
+          break;
+        }
+        #endif
+        c.write((const uint8_t*)buf, len);
+      }
+    }
+    #endif
+  }
 
-        sprintf_P(buf, PSTR("{\"state\":{\"on\":%s,\"bri\":%u%s%s,\"alert\":\"none%s\",\"mode\":\"homeautomation\",\"reachable\":true},"
-                      "\"type\":\"%s\",\"name\":\"%s\",\"modelid\":\"%s\",\"manufacturername\":\"Philips\",\"productname\":\"E%u"
-                      "\",\"uniqueid\":\"%s\",\"swversion\":\"espalexa-2.7.0\"}")
-                      
-        , (dev->getValue())?"true":"false", dev->getLastValue()-1, buf_col, buf_ct, buf_cm, typeString(dev->getType()),
-        dev->getName().c_str(), modelidString(dev->getType()), static_cast<uint8_t>(dev->getType()), buf_lightid);
+  #ifndef ESPALEXA_ASYNC
+  //a new subscriber keeps the connection of its request open
+  void serveEventSubscribe()
+  {
+    httpServed = true;
+    EA_DEBUGLN("HTTP Req events");
+    for (uint8_t i = 0; i < Config::eventClients; i++)
+    {
+      if (eventClients[i] && eventClients[i].connected()) continue;
+      eventClients[i] = server->client();
+      eventClients[i].setNoDelay(true);
+      eventClients[i].print(F("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n\r\n"));
+      eventCursors[i] = eventCount;
+      return;
     }
+    sendResponse(503, "text/plain", "Too many subscribers (espalexa)");
   }
-  
+  #endif
+
+  //bridge config JSON string, answers /api/<user>/config and is part of the full state. The MAC is the cached one of this bridge
+  void configJsonString(char* buf)
+  {
+    char s[16];
+    localIPString(s);
+
+    sprintf_P(buf, PSTR("{\"name\":\"Espalexa\",\"datastoreversion\":\"98\",\"swversion\":\"1935144040\",\"apiversion\":\"1.17.0\","
+                        "\"mac\":\"%s\",\"bridgeid\":\"%s\",\"modelid\":\"BSB002\",\"factorynew\":false,\"replacesbridgeid\":null,"
+                        "\"dhcp\":true,\"ipaddress\":\"%s\",\"linkbutton\":false,\"portalservices\":false}"),
+                        lightIdPrefix, escapedMac.c_str(), s);
+  }
+
+  //heap is sampled at points where a request likely holds the most memory, e.g. right before a response is sent
+  void heapSample()
+  {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap < heapReqMin) heapReqMin = freeHeap;
+    if (freeHeap < heapLoopMin) heapLoopMin = freeHeap;
+  }
+
+  void heapRecord(EspalexaRequestType t, uint32_t used)
+  {
+    EspalexaHeapStats& st = heapStats[static_cast<uint8_t>(t)];
+    st.requests++;
+    st.heapUsed += used;
+    if (used > st.peakHeapUsed) st.peakHeapUsed = used;
+    if (st.budget && used > st.budget)
+    {
+      st.overBudget++;
+      EA_DEBUG("Heap budget exceeded by request type ");
+      EA_DEBUGLN(static_cast<uint8_t>(t));
+    }
+  }
+
+  //a request is recorded when the next one begins or the loop() iteration ends
+  void heapRequestBegin(EspalexaRequestType t)
+  {
+    heapRequestEnd();
+    heapReqType = t;
+    heapReqOpen = true;
+    heapReqStart = ESP.getFreeHeap();
+    heapReqMin = heapReqStart;
+  }
+
+  void heapRequestEnd()
+  {
+    if (!heapReqOpen) return;
+    heapSample();
+    heapReqOpen = false;
+    heapRecord(heapReqType, heapReqStart - heapReqMin);
+  }
+
+  //slot for the next added device, Config::maxDevices if all are taken. Slots that never held a device come first,
+  //as a device in a reused slot gets the API key and unique id Alexa still knows the removed device by
+  uint8_t freeSlot()
+  {
+    if (slotsUsed < Config::maxDevices) return slotsUsed;
+    for (uint8_t i = 0; i < Config::maxDevices; i++)
+    {
+      if (devices[i] == nullptr) return i;
+    }
+    return Config::maxDevices;
+  }
+
+  //true if d is in a slot of this bridge or of a bridge linked after it
+  bool holdsDevice(EspalexaDevice* d)
+  {
+    for (EspalexaT* b = this; b != nullptr; b = b->nextBridge)
+    {
+      for (uint8_t i = 0; i < b->currentDeviceCount; i++)
+      {
+        if (b->devices[i] == d) return true;
+      }
+    }
+    return false;
+  }
+
+  //called after freeSlot() found room, so the device stays in this bridge
+  uint8_t addOwnedDevice(EspalexaDevice* d)
+  {
+    uint8_t id = addDevice(d);
+    if (id) deviceOwned[id-1] = true;
+    return id;
+  }
+
+  //id of a device added to the next linked bridge, as seen from this bridge
+  static uint16_t spilledId(uint16_t id)
+  {
+    return id ? id + Config::maxDevices : 0;
+  }
+
+  const char* tracePointString(EspalexaTracePoint p)
+  {
+    switch (p)
+    {
+      case EspalexaTracePoint::http:     return "http";
+      case EspalexaTracePoint::udp:      return "udp";
+      case EspalexaTracePoint::request:  return "request";
+      case EspalexaTracePoint::state:    return "state";
+      case EspalexaTracePoint::callback: return "callback";
+      default:                           return "send";
+    }
+  }
+
+  //trace ring buffer as Chrome trace JSON (chrome://tracing or ui.perfetto.dev), oldest event first
+  void serveTrace()
+  {
+    httpServed = true;
+    beginJsonStream();
+    uint32_t end = traceCount -1; //leave out the begin of this response, its end is not traced yet
+    uint32_t first = (traceCount > Config::traceSize) ? traceCount - Config::traceSize : 0;
+    char buf[512];
+    char* p = jsonAppendP(buf, PSTR("{\"traceEvents\":["));
+    for (uint32_t n = first; n != end; n++)
+    {
+      const EspalexaTraceEvent& e = traceEvents[n % Config::traceSize];
+      if (p - buf > 400)
+      {
+        streamJson(buf);
+        p = buf;
+      }
+      if (n != first) *p++ = ',';
+      p = jsonAppendP(p, PSTR("{\"name\":\""));
+      p = jsonAppend(p, tracePointString(e.point));
+      p = jsonAppendP(p, PSTR("\",\"ph\":\""));
+      *p++ = e.ph;
+      p = jsonAppendP(p, PSTR("\",\"ts\":"));
+      p = jsonAppendUInt(p, e.ts);
+      p = jsonAppendP(p, PSTR(",\"pid\":1,\"tid\":1}"));
+    }
+    jsonAppendP(p, PSTR("]}"));
+    streamJson(buf);
+    endJsonStream();
+  }
+
+  //transport: request handlers only talk to the HTTP server and UDP socket through the functions below
+  void localIPString(char* s)
+  {
+    IPAddress localIP = (uint32_t)bridgeIP ? bridgeIP : WiFi.localIP();
+    sprintf(s, "%d.%d.%d.%d", localIP[0], localIP[1], localIP[2], localIP[3]);
+  }
+
+  void sendResponse(int code, const char* type, const String& content)
+  {
+    EA_HEAP_SAMPLE();
+    EA_TRACE(send, 'B');
+    #ifdef ESPALEXA_ASYNC
+    if (pendingEtag[0])
+    {
+      AsyncWebServerResponse* response = server->beginResponse(code, type, content);
+      response->addHeader("ETag", pendingEtag);
+      pendingEtag[0] = 0;
+      server->send(response);
+    } else
+    #endif
+    server->send(code, type, content);
+    EA_TRACE(send, 'E');
+    EA_HEAP_SAMPLE();
+  }
+
+  void sendResponse(int code, const char* type, const char* content)
+  {
+    #ifdef ESPALEXA_ASYNC
+    sendResponse(code, type, String(content)); //the async server copies the content into a String anyway
+    #else
+    EA_HEAP_SAMPLE();
+    EA_TRACE(send, 'B');
+    server->send(code, type, content);
+    EA_TRACE(send, 'E');
+    EA_HEAP_SAMPLE();
+    #endif
+  }
+
+  //conditional GET: answers 304 if the client already has the current device state.
+  //Otherwise the ETag is sent with the next response. Sync servers only see If-None-Match if it is in collectHeaders()
+  bool sendNotModified()
+  {
+    char etag[32];
+    //the state version starts over at each boot, so a tag from before a reboot must not match
+    sprintf(etag, "\"%lx-%lx-%lx\"", (unsigned long)mac24, (unsigned long)bootId, (unsigned long)EspalexaDevice::getStateVersion());
+    #ifdef ESPALEXA_ASYNC
+    if (server->hasHeader("If-None-Match") && server->getHeader("If-None-Match")->value() == etag)
+    {
+      AsyncWebServerResponse* response = server->beginResponse(304);
+      response->addHeader("ETag", etag);
+      server->send(response);
+      return true;
+    }
+    strcpy(pendingEtag, etag);
+    #else
+    server->sendHeader("ETag", etag);
+    if (server->header("If-None-Match") == etag)
+    {
+      server->send(304);
+      return true;
+    }
+    #endif
+    return false;
+  }
+
+  //reply to the sender of the last received SSDP datagram, or to reply if given
+  void sendUdpReply(const char* buf, Print* reply)
+  {
+    if (reply != nullptr)
+    {
+      reply->write((const uint8_t*)buf, strlen(buf));
+      return;
+    }
+    WiFiUDP& udp = udpBridge->espalexaUdp;
+    udp.beginPacket(udp.remoteIP(), udp.remotePort());
+    #ifdef ARDUINO_ARCH_ESP32
+    udp.write((uint8_t*)buf, strlen(buf));
+    #else
+    udp.write(buf);
+    #endif
+    udp.endPacket();
+    EA_HEAP_SAMPLE();
+  }
+
+  //chunked JSON response. The sync server sends each chunk right away, the async server buffers the whole response (used for the trace only)
+  void beginJsonStream()
+  {
+    EA_TRACE(send, 'B');
+    #ifdef ESPALEXA_ASYNC
+    jsonStream = server->beginResponseStream("application/json");
+    if (pendingEtag[0])
+    {
+      jsonStream->addHeader("ETag", pendingEtag);
+      pendingEtag[0] = 0;
+    }
+    #else
+    server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server->send(200, "application/json", "");
+    #endif
+  }
+
+  void streamJson(const char* s)
+  {
+    EA_HEAP_SAMPLE();
+    #ifdef ESPALEXA_ASYNC
+    jsonStream->print(s);
+    #else
+    server->sendContent(s);
+    #endif
+  }
+
+  void endJsonStream()
+  {
+    #ifdef ESPALEXA_ASYNC
+    server->send(jsonStream);
+    jsonStream = nullptr;
+    #else
+    server->sendContent("");
+    #endif
+    EA_TRACE(send, 'E');
+  }
+
+  //position in the lights dict or full state JSON while it is sent
+  struct JsonCursor {
+    bool fullState;
+    uint8_t step;  //0 start, 1 devices, 2 end, 3 done
+    uint8_t slot;
+    bool first;
+  };
+
+  //renders the next piece of the lights dict or full state into buf (ESPALEXA_JSON_DEVICE_MAXLEN +16 bytes), false after the last one.
+  //A piece holds at most one device, so memory use does not grow with the device count
+  bool nextJsonPiece(JsonCursor& c, char* buf)
+  {
+    switch (c.step)
+    {
+      case 0:
+        strcpy_P(buf, c.fullState ? PSTR("{\"lights\":{") : PSTR("{"));
+        c.step = 1;
+        return true;
+      case 1:
+        while (c.slot < currentDeviceCount && devices[c.slot] == nullptr) c.slot++;
+        if (c.slot < currentDeviceCount)
+        {
+          int len = sprintf(buf, "%s\"%d\":", c.first ? "" : ",", encodeLightKey(c.slot));
+          c.first = false;
+          deviceJsonString(devices[c.slot], buf + len);
+          c.slot++;
+          return true;
+        }
+        c.step = 2;
+        //fall through
+      case 2:
+        if (c.fullState)
+        {
+          strcpy_P(buf, PSTR("},\"groups\":{},\"config\":"));
+          configJsonString(buf + strlen(buf));
+          strcat_P(buf, PSTR(",\"schedules\":{},\"scenes\":{},\"rules\":{},\"sensors\":{},\"resourcelinks\":{}}"));
+        } else {
+          strcpy(buf, "}");
+        }
+        c.step = 3;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  //sends all lights as JSON dict, or the full bridge state which lets a client sync all lights with a single request
+  void sendLightsJson(bool fullState)
+  {
+    JsonCursor c = {fullState, 0, 0, true};
+    #ifdef ESPALEXA_ASYNC
+    //the async server pulls the response piece by piece while the client takes data
+    struct Filler {
+      JsonCursor c;
+      size_t len = 0, sent = 0;
+      char buf[ESPALEXA_JSON_DEVICE_MAXLEN +16];
+    };
+    std::shared_ptr<Filler> f(new Filler());
+    f->c = c;
+    EA_TRACE(send, 'B');
+    AsyncWebServerResponse* response = server->beginChunkedResponse("application/json", [this, f](uint8_t* out, size_t maxLen, size_t index) -> size_t
+    {
+      if (f->sent == f->len)
+      {
+        if (!nextJsonPiece(f->c, f->buf)) return 0;
+        f->len = strlen(f->buf);
+        f->sent = 0;
+      }
+      size_t n = f->len - f->sent;
+      if (n > maxLen) n = maxLen;
+      memcpy(out, f->buf + f->sent, n);
+      f->sent += n;
+      return n;
+    });
+    if (pendingEtag[0])
+    {
+      response->addHeader("ETag", pendingEtag);
+      pendingEtag[0] = 0;
+    }
+    server->send(response);
+    EA_TRACE(send, 'E');
+    #else
+    char buf[ESPALEXA_JSON_DEVICE_MAXLEN +16];
+    beginJsonStream();
+    while (nextJsonPiece(c, buf)) streamJson(buf);
+    endJsonStream();
+    #endif
+  }
+
   //Espalexa status page /espalexa
-  #ifndef ESPALEXA_NO_SUBPAGE
   void servePage()
   {
+    httpServed = true;
+    EA_HEAP_BEGIN(page);
     EA_DEBUGLN("HTTP Req espalexa ...\n");
     String res = "Hello from Espalexa!\r\n\r\n";
     for (int i=0; i<currentDeviceCount; i++)
     {
       EspalexaDevice* dev = devices[i];
+      if (dev == nullptr) continue;
       res += "Value of device " + String(i+1) + " (" + dev->getName() + "): " + String(dev->getValue()) + " (" + typeString(dev->getType());
-      if (static_cast<uint8_t>(dev->getType()) > 1) //color support
+      if (Config::colorSupport && static_cast<uint8_t>(dev->getType()) > 1) //color support
       {
         res += ", colormode=" + String(modeString(dev->getColorMode())) + ", r=" + String(dev->getR()) + ", g=" + String(dev->getG()) + ", b=" + String(dev->getB());
         res +=", ct=" + String(dev->getCt()) + ", hue=" + String(dev->getHue()) + ", sat=" + String(dev->getSat()) + ", x=" + String(dev->getX()) + ", y=" + String(dev->getY());
@@ -204,42 +955,47 @@ private:
     res += "\r\nFree Heap: " + (String)ESP.getFreeHeap();
     res += "\r\nUptime: " + (String)millis();
     res += "\r\n\r\nEspalexa library v2.7.0 by Christian Schwinne 2021";
-    server->send(200, "text/plain", res);
+    sendResponse(200, "text/plain", res);
   }
-  #endif
 
   //not found URI (only if internal webserver is used)
   void serveNotFound()
   {
+    httpServed = true;
     EA_DEBUGLN("Not-Found HTTP call:");
     #ifndef ESPALEXA_ASYNC
-    EA_DEBUGLN("URI: " + server->uri());
-    EA_DEBUGLN("Body: " + server->arg(0));
-    if(!handleAlexaApiCall(server->uri(), server->arg(0)))
+    EA_HEAP_BEGIN(other); //before the copies below, which are part of the request's heap use
+    String req = server->uri();
+    String body = server->arg(0);
+    EA_DEBUGLN("URI: " + req);
+    EA_DEBUGLN("Body: " + body);
+    if(!apiCall(req, body))
     #else
     EA_DEBUGLN("URI: " + server->url());
     EA_DEBUGLN("Body: " + body);
     if(!handleAlexaApiCall(server))
     #endif
-      server->send(404, "text/plain", "Not Found (espalexa)");
+      sendResponse(404, "text/plain", "Not Found (espalexa)");
   }
 
   //send description.xml device property page
   void serveDescription()
   {
+    httpServed = true;
+    EA_HEAP_BEGIN(description);
     EA_DEBUGLN("# Responding to description.xml ... #\n");
-    IPAddress localIP = WiFi.localIP();
+    if (Config::record) recordTraffic("HTTP", "/description.xml", "", 0);
     char s[16];
-    sprintf(s, "%d.%d.%d.%d", localIP[0], localIP[1], localIP[2], localIP[3]);
+    localIPString(s);
     char buf[1024];
     
     sprintf_P(buf,PSTR("<?xml version=\"1.0\" ?>"
         "<root xmlns=\"urn:schemas-upnp-org:device-1-0\">"
         "<specVersion><major>1</major><minor>0</minor></specVersion>"
-        "<URLBase>http://%s:80/</URLBase>"
+        "<URLBase>http://%s:%u/</URLBase>"
         "<device>"
           "<deviceType>urn:schemas-upnp-org:device:Basic:1</deviceType>"
-          "<friendlyName>Espalexa (%s:80)</friendlyName>"
+          "<friendlyName>Espalexa (%s:%u)</friendlyName>"
           "<manufacturer>Royal Philips Electronics</manufacturer>"
           "<manufacturerURL>http://www.philips.com</manufacturerURL>"
           "<modelDescription>Philips hue Personal Wireless Lighting</modelDescription>"
@@ -250,20 +1006,36 @@ private:
           "<UDN>uuid:2f402f80-da50-11e1-9b23-%s</UDN>"
           "<presentationURL>index.html</presentationURL>"
         "</device>"
-        "</root>"),s,s,escapedMac.c_str(),escapedMac.c_str());
+        "</root>"),s,httpPort,s,httpPort,escapedMac.c_str(),escapedMac.c_str());
           
-    server->send(200, "text/xml", buf);
+    sendResponse(200, "text/xml", buf);
     
     EA_DEBUGLN("Send setup.xml");
     EA_DEBUGLN(buf);
   }
   
+  //capture record: "#EA <millis> <kind> <path> <length>\n" followed by <length> bytes of payload and "\n"
+  void recordTraffic(const char* kind, const char* path, const char* data, size_t len)
+  {
+    Print& out = Config::recordStream();
+    out.print(F("#EA "));
+    out.print(millis());
+    out.print(' ');
+    out.print(kind);
+    out.print(' ');
+    out.print(path);
+    out.print(' ');
+    out.println(len);
+    out.write((const uint8_t*)data, len);
+    out.println();
+  }
+
   //init the server
   void startHttpServer()
   {
     #ifdef ESPALEXA_ASYNC
     if (serverAsync == nullptr) {
-      serverAsync = new AsyncWebServer(80);
+      serverAsync = new AsyncWebServer(httpPort);
       serverAsync->onNotFound([=](AsyncWebServerRequest *request){server = request; serveNotFound();});
     }
     
@@ -275,60 +1047,108 @@ private:
       EA_DEBUG("Received body: ");
       EA_DEBUGLN(body);
     });
-    #ifndef ESPALEXA_NO_SUBPAGE
-    serverAsync->on("/espalexa", HTTP_GET, [=](AsyncWebServerRequest *request){server = request; servePage();});
-    #endif
+    if (Config::trace)
+      serverAsync->on("/espalexa/trace", HTTP_GET, [=](AsyncWebServerRequest *request){server = request; serveTrace();}); //before /espalexa, which would also match this URL
+    if (Config::events)
+    {
+      if (eventSource == nullptr) eventSource = new AsyncEventSource("/espalexa/events");
+      serverAsync->addHandler(eventSource); //before /espalexa, which would also match this URL
+    }
+    if (Config::statusPage)
+      serverAsync->on("/espalexa", HTTP_GET, [=](AsyncWebServerRequest *request){server = request; servePage();});
     serverAsync->on("/description.xml", HTTP_GET, [=](AsyncWebServerRequest *request){server = request; serveDescription();});
     serverAsync->begin();
     
     #else
     if (server == nullptr) {
       #ifdef ARDUINO_ARCH_ESP32
-      server = new WebServer(80);
+      server = (uint32_t)bridgeIP ? new WebServer(bridgeIP, httpPort) : new WebServer(httpPort);
       #else
-      server = new ESP8266WebServer(80);  
+      server = (uint32_t)bridgeIP ? new ESP8266WebServer(bridgeIP, httpPort) : new ESP8266WebServer(httpPort);
       #endif
       server->onNotFound([=](){serveNotFound();});
+      const char* headerKeys[] = {"If-None-Match"};
+      server->collectHeaders(headerKeys, 1);
     }
 
-    #ifndef ESPALEXA_NO_SUBPAGE
-    server->on("/espalexa", HTTP_GET, [=](){servePage();});
-    #endif
+    if (Config::statusPage)
+      server->on("/espalexa", HTTP_GET, [=](){servePage();});
+    if (Config::events)
+      server->on("/espalexa/events", HTTP_GET, [=](){serveEventSubscribe();});
+    if (Config::trace)
+      server->on("/espalexa/trace", HTTP_GET, [=](){serveTrace();});
     server->on("/description.xml", HTTP_GET, [=](){serveDescription();});
     server->begin();
     #endif
   }
 
   //respond to UDP SSDP M-SEARCH
-  void respondToSearch()
+  void respondToSearch(Print* reply)
   {
-    IPAddress localIP = WiFi.localIP();
     char s[16];
-    sprintf(s, "%d.%d.%d.%d", localIP[0], localIP[1], localIP[2], localIP[3]);
+    localIPString(s);
 
     char buf[1024];
 
     sprintf_P(buf,PSTR("HTTP/1.1 200 OK\r\n"
       "EXT:\r\n"
       "CACHE-CONTROL: max-age=100\r\n" // SSDP_INTERVAL
-      "LOCATION: http://%s:80/description.xml\r\n"
+      "LOCATION: http://%s:%u/description.xml\r\n"
       "SERVER: FreeRTOS/6.0.5, UPnP/1.0, IpBridge/1.17.0\r\n" // _modelName, _modelNumber
       "hue-bridgeid: %s\r\n"
       "ST: urn:schemas-upnp-org:device:basic:1\r\n"  // _deviceType
       "USN: uuid:2f402f80-da50-11e1-9b23-%s::upnp:rootdevice\r\n" // _uuid::_deviceType
-      "\r\n"),s,escapedMac.c_str(),escapedMac.c_str());
+      "\r\n"),s,httpPort,escapedMac.c_str(),escapedMac.c_str());
 
-    espalexaUdp.beginPacket(espalexaUdp.remoteIP(), espalexaUdp.remotePort());
-    #ifdef ARDUINO_ARCH_ESP32
-    espalexaUdp.write((uint8_t*)buf, strlen(buf));
-    #else
-    espalexaUdp.write(buf);
+    sendUdpReply(buf, reply);
+  }
+
+  //polls server and UDP, called by loop()
+  void serviceLoop() {
+    loopBusy = false;
+    loopWaiting = false;
+    #ifndef ESPALEXA_ASYNC
+    if (server == nullptr) return; //only if begin() was not called
+    //calling handleClient() repeatedly lets queued clients and further requests on a kept-alive connection be served in this iteration
+    //a served request makes the loop busy even if its connection is closed by now, so the sketch does not sleep with further clients queued
+    unsigned long httpStart = millis();
+    for (uint8_t i = 0; i < Config::httpMaxClients; i++)
+    {
+      EA_TRACE(http, 'B');
+      httpServed = false;
+      server->handleClient();
+      if (httpServed) loopBusy = true;
+      if (Config::trace && !httpServed) traceCount--; //nothing was served, keep idle polls out of the ring buffer
+      else EA_TRACE(http, 'E');
+      if (Config::httpMaxClients > 1 && millis() - httpStart >= Config::httpBudgetMs) break;
+    }
+    if (server->client().connected()) //request in progress or kept-alive connection
+    {
+      if (server->client().available()) loopBusy = true;
+      else loopWaiting = true; //idle keep-alive, the next request may take a while
+    }
     #endif
-    espalexaUdp.endPacket();                    
+    if (Config::events) serveEvents();
+    
+    if (!udpConnected) return;   
+    int packetSize = espalexaUdp.parsePacket();    
+    if (packetSize < 1) return; //no new udp packet
+    
+    EA_DEBUGLN("Got UDP!");
+    loopBusy = true;
+
+    unsigned char packetBuffer[packetSize+1]; //buffer to hold incoming udp packet
+    espalexaUdp.read(packetBuffer, packetSize);
+    packetBuffer[packetSize] = 0;
+  
+    // espalexaUdp.flush();
+    EA_TRACE(udp, 'B');
+    handleUdpPacket((const char *) packetBuffer);
+    EA_TRACE(udp, 'E');
   }
 
 public:
-  Espalexa(){}
+  EspalexaT(){}
 
   //initialize interfaces
   #ifdef ESPALEXA_ASYNC
@@ -341,19 +1161,39 @@ public:
   {
     EA_DEBUGLN("Espalexa Begin...");
     EA_DEBUG("MAXDEVICES ");
-    EA_DEBUGLN(ESPALEXA_MAXDEVICES);
-    escapedMac = WiFi.macAddress();
-    escapedMac.replace(":", "");
-    escapedMac.toLowerCase();
+    EA_DEBUGLN(Config::maxDevices);
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    if (bridgeIndex) //every bridge needs its own identity. The first one uses the real MAC, the others a locally administered one no real device has
+    {
+      mac[0] |= 0x02;
+      mac[3] ^= bridgeIndex; //not the last byte, which is what usually differs between ESPs of one batch
+    }
 
-    String macSubStr = escapedMac.substring(6, 12);
-    mac24 = strtol(macSubStr.c_str(), 0, 16);
+    char macStr[13];
+    sprintf(macStr, "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    escapedMac = macStr;
+    mac24 = ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+    bootId = micros(); //the time WiFi took to connect differs from boot to boot
+
+    char* p = lightIdPrefix;
+    for (uint8_t i = 0; i < 6; i++)
+    {
+      if (i) *p++ = ':';
+      p = jsonAppendHex(p, mac[i]);
+    }
 
     #ifdef ESPALEXA_ASYNC
     serverAsync = externalServer;
     #else
     server = externalServer;
     #endif
+    if (udpBridge != this) //linked bridge, SSDP is answered by the first bridge
+    {
+      startHttpServer();
+      EA_DEBUGLN("Done");
+      return true;
+    }
     #ifdef ARDUINO_ARCH_ESP32
     udpConnected = espalexaUdp.beginMulticast(IPAddress(239, 255, 255, 250), 1900);
     #else
@@ -372,25 +1212,24 @@ public:
 
   //service loop
   void loop() {
-    #ifndef ESPALEXA_ASYNC
-    if (server == nullptr) return; //only if begin() was not called
-    server->handleClient();
-    #endif
-    
-    if (!udpConnected) return;   
-    int packetSize = espalexaUdp.parsePacket();    
-    if (packetSize < 1) return; //no new udp packet
-    
-    EA_DEBUGLN("Got UDP!");
+    if (!Config::heapStats)
+    {
+      serviceLoop();
+      return;
+    }
+    heapLoopStart = ESP.getFreeHeap();
+    heapLoopMin = heapLoopStart;
+    serviceLoop();
+    heapRequestEnd();
+    heapRecord(EspalexaRequestType::loop, heapLoopStart - heapLoopMin);
+  }
 
-    unsigned char packetBuffer[packetSize+1]; //buffer to hold incoming udp packet
-    espalexaUdp.read(packetBuffer, packetSize);
-    packetBuffer[packetSize] = 0;
-  
-    // espalexaUdp.flush();
-    if (!discoverable) return; //do not reply to M-SEARCH if not discoverable
-  
-    const char* request = (const char *) packetBuffer;
+  //handle a received SSDP datagram. Called by loop(), public so that recorded traffic can be replayed.
+  //Replies are written to reply if given, instead of being sent to the sender of the last datagram on the SSDP socket
+  void handleUdpPacket(const char* request, Print* reply = nullptr)
+  {
+    EA_HEAP_BEGIN(ssdp);
+    if (Config::record) recordTraffic("UDP", "-", request, strlen(request));
     if (strstr(request, "M-SEARCH") == nullptr) return;
 
     EA_DEBUGLN(request);
@@ -400,56 +1239,149 @@ public:
          strstr(request, "asic:1")     != nullptr )) //short for "device:basic:1"
     {
       EA_DEBUGLN("Responding search req...");
-      respondToSearch();
+      for (EspalexaT* b = this; b != nullptr; b = b->nextBridge) //this bridge and all linked to it
+      {
+        if (b->discoverable) b->respondToSearch(reply); //do not reply to M-SEARCH if not discoverable
+      }
     }
   }
 
-  // returns device index or 0 on failure
-  uint8_t addDevice(EspalexaDevice* d)
+  // returns device id or 0 on failure, also if d was already added. If this bridge is full, the device is added to the next linked bridge.
+  // Ids above Config::maxDevices are in linked bridges: maxDevices+1 is the first slot of the next bridge, and so on
+  uint16_t addDevice(EspalexaDevice* d)
   {
+    if (d == nullptr || holdsDevice(d)) return 0;
+    uint8_t idx = freeSlot();
+    if (idx >= Config::maxDevices && nextBridge != nullptr) return spilledId(nextBridge->addDevice(d));
     EA_DEBUG("Adding device ");
-    EA_DEBUGLN((currentDeviceCount+1));
-    if (currentDeviceCount >= ESPALEXA_MAXDEVICES) return 0;
-    if (d == nullptr) return 0;
-    d->setId(currentDeviceCount);
-    devices[currentDeviceCount] = d;
-    return ++currentDeviceCount;
+    EA_DEBUGLN((idx+1));
+    if (idx >= Config::maxDevices) return 0;
+    d->setId(idx, idBase);
+    devices[idx] = d;
+    deviceOwned[idx] = false;
+    if (idx >= currentDeviceCount) currentDeviceCount = idx +1;
+    if (idx >= slotsUsed) slotsUsed = idx +1;
+    return idx +1;
   }
   
   //brightness-only callback
-  uint8_t addDevice(String deviceName, BrightnessCallbackFunction callback, uint8_t initialValue = 0)
+  uint16_t addDevice(String deviceName, BrightnessCallbackFunction callback, uint8_t initialValue = 0)
   {
     EA_DEBUG("Constructing device ");
-    EA_DEBUGLN((currentDeviceCount+1));
-    if (currentDeviceCount >= ESPALEXA_MAXDEVICES) return 0;
+    EA_DEBUGLN((freeSlot()+1));
+    if (freeSlot() >= Config::maxDevices && nextBridge != nullptr) return spilledId(nextBridge->addDevice(deviceName, callback, initialValue));
+    if (freeSlot() >= Config::maxDevices) return 0;
     EspalexaDevice* d = new EspalexaDevice(deviceName, callback, initialValue);
-    return addDevice(d);
+    return addOwnedDevice(d);
   }
   
   //brightness-only callback
-  uint8_t addDevice(String deviceName, ColorCallbackFunction callback, uint8_t initialValue = 0)
+  uint16_t addDevice(String deviceName, ColorCallbackFunction callback, uint8_t initialValue = 0)
   {
     EA_DEBUG("Constructing device ");
-    EA_DEBUGLN((currentDeviceCount+1));
-    if (currentDeviceCount >= ESPALEXA_MAXDEVICES) return 0;
+    EA_DEBUGLN((freeSlot()+1));
+    if (freeSlot() >= Config::maxDevices && nextBridge != nullptr) return spilledId(nextBridge->addDevice(deviceName, callback, initialValue));
+    if (freeSlot() >= Config::maxDevices) return 0;
     EspalexaDevice* d = new EspalexaDevice(deviceName, callback, initialValue);
-    return addDevice(d);
+    return addOwnedDevice(d);
   }
 
 
-  uint8_t addDevice(String deviceName, DeviceCallbackFunction callback, EspalexaDeviceType t = EspalexaDeviceType::dimmable, uint8_t initialValue = 0)
+  uint16_t addDevice(String deviceName, DeviceCallbackFunction callback, EspalexaDeviceType t = EspalexaDeviceType::dimmable, uint8_t initialValue = 0)
   {
     EA_DEBUG("Constructing device ");
-    EA_DEBUGLN((currentDeviceCount+1));
-    if (currentDeviceCount >= ESPALEXA_MAXDEVICES) return 0;
+    EA_DEBUGLN((freeSlot()+1));
+    if (freeSlot() >= Config::maxDevices && nextBridge != nullptr) return spilledId(nextBridge->addDevice(deviceName, callback, t, initialValue));
+    if (freeSlot() >= Config::maxDevices) return 0;
     EspalexaDevice* d = new EspalexaDevice(deviceName, callback, t, initialValue);
-    return addDevice(d);
+    return addOwnedDevice(d);
+  }
+
+  //removes the device. Devices created by addDevice(name, ...) are deleted. The slot is only reused once all slots have been used
+  bool removeDevice(uint16_t id)
+  {
+    if (id > Config::maxDevices) return nextBridge != nullptr && nextBridge->removeDevice(id - Config::maxDevices);
+    unsigned int index = id - 1;
+    if (index >= currentDeviceCount || devices[index] == nullptr) return false;
+    EA_DEBUG("Removing device ");
+    EA_DEBUGLN(id);
+    if (deviceOwned[index]) delete devices[index];
+    devices[index] = nullptr;
+    EspalexaDevice::markStateChanged();
+    deviceOwned[index] = false;
+    while (currentDeviceCount > 0 && devices[currentDeviceCount-1] == nullptr) currentDeviceCount--;
+    return true;
   }
 
-  void renameDevice(uint8_t id, const String& deviceName)
+  //puts another device in the slot of device id. It keeps the API key and unique id, so Alexa keeps controlling it without rediscovery.
+  //Fails if d is already in another slot
+  bool replaceDevice(uint16_t id, EspalexaDevice* d)
   {
+    if (id > Config::maxDevices) return nextBridge != nullptr && nextBridge->replaceDevice(id - Config::maxDevices, d);
     unsigned int index = id - 1;
-    if (index < currentDeviceCount)
+    if (d == nullptr || index >= currentDeviceCount || devices[index] == nullptr) return false;
+    if (devices[index] == d) return true; //same device, it stays owned if Espalexa constructed it
+    if (holdsDevice(d)) return false;
+    EA_DEBUG("Replacing device ");
+    EA_DEBUGLN(id);
+    if (deviceOwned[index]) delete devices[index];
+    d->setId(index, idBase);
+    devices[index] = d;
+    deviceOwned[index] = false;
+    return true;
+  }
+
+  //set the identity of this bridge before begin(), if more than one bridge runs on this ESP (each needs another index and port)
+  void setBridge(uint8_t index, uint16_t port)
+  {
+    bridgeIndex = index;
+    httpPort = port;
+  }
+
+  //same, for a bridge advertised on an address of its own (e.g. the soft AP's), so bridges can share a port.
+  //The synchronous server begin() creates listens on ip only, the async one on all addresses
+  void setBridge(uint8_t index, uint16_t port, IPAddress ip)
+  {
+    setBridge(index, port);
+    bridgeIP = ip;
+  }
+
+  //attach another bridge, before calling begin() on it. It answers SSDP through this bridge and gets the devices that don't fit here
+  void linkBridge(EspalexaT* b)
+  {
+    if (b == nullptr || b == this) return;
+    EspalexaT* last = this;
+    while (last->nextBridge != nullptr) last = last->nextBridge;
+    last->nextBridge = b;
+    b->udpBridge = udpBridge;
+    b->idBase = last->idBase + Config::maxDevices;
+    for (uint8_t i = 0; i < b->currentDeviceCount; i++) if (b->devices[i] != nullptr) b->devices[i]->setId(i, b->idBase);
+  }
+
+  //add a statically allocated device table in one go, no heap is used
+  //returns the id of the last device added or 0 on failure
+  template <size_t N>
+  uint16_t addDevices(EspalexaDevice (&d)[N])
+  {
+    static_assert(N <= Config::maxDevices, "device table is larger than Config::maxDevices");
+    uint16_t res = 0;
+    for (size_t i = 0; i < N; i++)
+    {
+      res = addDevice(&d[i]);
+      if (res == 0) return 0;
+    }
+    return res;
+  }
+
+  void renameDevice(uint16_t id, const String& deviceName)
+  {
+    if (id > Config::maxDevices)
+    {
+      if (nextBridge != nullptr) nextBridge->renameDevice(id - Config::maxDevices, deviceName);
+      return;
+    }
+    unsigned int index = id - 1;
+    if (index < currentDeviceCount && devices[index] != nullptr)
       devices[index]->setName(deviceName);
   }
 
@@ -457,6 +1389,7 @@ public:
   #ifdef ESPALEXA_ASYNC
   bool handleAlexaApiCall(AsyncWebServerRequest* request)
   {
+    EA_HEAP_BEGIN(other);
     server = request; //copy request reference
     String req = request->url(); //body from global variable
     EA_DEBUGLN(request->contentType());
@@ -467,40 +1400,61 @@ public:
     }
     EA_DEBUG("FinalBody: ");
     EA_DEBUGLN(body);
+    return apiCall(req, body);
+  }
   #else
   bool handleAlexaApiCall(String req, String body)
   {  
+    EA_HEAP_BEGIN(other);
+    return apiCall(req, body);
+  }
   #endif
+
+private:
+  //handles a Hue API request. The heap use record of the request is begun by the caller, so it is only counted once
+  bool apiCall(String& req, String& body)
+  {
+    httpServed = true;
+    EA_TRACE(request, 'i');
     EA_DEBUGLN("AlexaApiCall");
+    if (Config::record) recordTraffic("HTTP", req.c_str(), body.c_str(), body.length());
     if (req.indexOf("api") <0) return false; //return if not an API call
     EA_DEBUGLN("ok");
 
     if (body.indexOf("devicetype") > 0) //client wants a hue api username, we don't care and give static
     {
       EA_DEBUGLN("devType");
+      EA_HEAP_TYPE(username);
       body = "";
-      server->send(200, "application/json", F("[{\"success\":{\"username\":\"2WLEDHardQrI3WHYTHoMcXHgEspsM8ZZRpSKtBQr\"}}]"));
+      sendResponse(200, "application/json", F("[{\"success\":{\"username\":\"2WLEDHardQrI3WHYTHoMcXHgEspsM8ZZRpSKtBQr\"}}]"));
       return true;
     }
 
     if ((req.indexOf("state") > 0) && (body.length() > 0)) //client wants to control light
     {
-      server->send(200, "application/json", F("[{\"success\":{\"/lights/1/state/\": true}}]"));
+      EA_HEAP_TYPE(state);
+      sendResponse(200, "application/json", F("[{\"success\":{\"/lights/1/state/\": true}}]"));
 
       uint32_t devId = req.substring(req.indexOf("lights")+7).toInt();
       EA_DEBUG("ls"); EA_DEBUGLN(devId);
       EA_DEBUGLN(devId);
       unsigned idx = decodeLightKey(devId);
-      if (idx >= currentDeviceCount) return true; //return if invalid ID
+      if (idx >= currentDeviceCount || devices[idx] == nullptr) return true; //return if invalid ID
       EspalexaDevice* dev = devices[idx];
       
+      EA_TRACE(state, 'B');
       dev->setPropertyChanged(EspalexaDeviceProperty::none);
       
       if (body.indexOf("false")>0) //OFF command
       {
         dev->setValue(0);
         dev->setPropertyChanged(EspalexaDeviceProperty::off);
+        EA_TRACE(state, 'E');
+        EA_TRACE(callback, 'B');
         dev->doCallback();
+        EA_TRACE(callback, 'E');
+        EA_HEAP_SAMPLE();
+        if (Config::events) queueEvent(dev);
         return true;
       }
       
@@ -522,30 +1476,33 @@ public:
         dev->setPropertyChanged(EspalexaDeviceProperty::bri);
       }
       
-      if (body.indexOf("xy")   >0) //COLOR command (XY mode)
+      if (Config::colorSupport && body.indexOf("xy")   >0) //COLOR command (XY mode)
       {
         dev->setColorXY(body.substring(body.indexOf("[") +1).toFloat(), body.substring(body.indexOf(",0") +1).toFloat());
         dev->setPropertyChanged(EspalexaDeviceProperty::xy);
       }
       
-      if (body.indexOf("hue")  >0) //COLOR command (HS mode)
+      if (Config::colorSupport && body.indexOf("hue")  >0) //COLOR command (HS mode)
       {
         dev->setColor(body.substring(body.indexOf("hue") +5).toInt(), body.substring(body.indexOf("sat") +5).toInt());
         dev->setPropertyChanged(EspalexaDeviceProperty::hs);
       }
       
-      if (body.indexOf("ct")   >0) //COLOR TEMP command (white spectrum)
+      if (Config::colorSupport && body.indexOf("ct")   >0) //COLOR TEMP command (white spectrum)
       {
         dev->setColor(body.substring(body.indexOf("ct") +4).toInt());
         dev->setPropertyChanged(EspalexaDeviceProperty::ct);
       }
       
+      EA_TRACE(state, 'E');
+      EA_TRACE(callback, 'B');
       dev->doCallback();
+      EA_TRACE(callback, 'E');
+      EA_HEAP_SAMPLE();
+      if (Config::events) queueEvent(dev);
       
-      #ifdef ESPALEXA_DEBUG
       if (dev->getLastChangedProperty() == EspalexaDeviceProperty::none)
         EA_DEBUGLN("STATE REQ WITHOUT BODY (likely Content-Type issue #6)");
-      #endif
       return true;
     }
     
@@ -558,42 +1515,70 @@ public:
       if (devId == 0) //client wants all lights
       {
         EA_DEBUGLN("lAll");
-        String jsonTemp = "{";
-        for (int i = 0; i<currentDeviceCount; i++)
-        {
-          jsonTemp += '"';
-          jsonTemp += encodeLightKey(i);
-          jsonTemp += '"';
-          jsonTemp += ':';
-
-          char buf[512];
-          deviceJsonString(devices[i], buf);
-          jsonTemp += buf;
-          if (i < currentDeviceCount-1) jsonTemp += ',';
-        }
-        jsonTemp += '}';
-        server->send(200, "application/json", jsonTemp);
+        EA_HEAP_TYPE(lights);
+        if (sendNotModified()) return true;
+        sendLightsJson(false);
       } else //client wants one light (devId)
       {
+        EA_HEAP_TYPE(light);
         EA_DEBUGLN(devId);
         unsigned idx = decodeLightKey(devId);
-        if (idx < currentDeviceCount)
+        if (idx < currentDeviceCount && devices[idx] != nullptr)
         {
-          char buf[512];
+          if (sendNotModified()) return true;
+          char buf[ESPALEXA_JSON_DEVICE_MAXLEN];
           deviceJsonString(devices[idx], buf);
-          server->send(200, "application/json", buf);
+          sendResponse(200, "application/json", buf);
         } else {
-          server->send(200, "application/json", "{}");
+          sendResponse(200, "application/json", "{}");
         }
       }
       
       return true;
     }
 
+    if (req.indexOf("/config") > 0) //client wants bridge config
+    {
+      EA_DEBUGLN("cfg");
+      EA_HEAP_TYPE(config);
+      char buf[400];
+      configJsonString(buf);
+      sendResponse(200, "application/json", buf);
+      return true;
+    }
+
+    pos = req.indexOf("api/");
+    if (pos >= 0 && req.length() > (unsigned)pos+4) //client wants full state (/api/<user>)
+    {
+      int slashPos = req.indexOf('/', pos+4);
+      if (slashPos < 0 || (unsigned)slashPos == req.length()-1)
+      {
+        EA_DEBUGLN("fullState");
+        EA_HEAP_TYPE(fullstate);
+        if (sendNotModified()) return true;
+        sendLightsJson(true);
+        return true;
+      }
+    }
+
     //we don't care about other api commands at this time and send empty JSON
-    server->send(200, "application/json", "{}");
+    sendResponse(200, "application/json", "{}");
     return true;
   }
+
+public:
+
+  //records a trace event: ph is 'B' or 'E' for the begin or end of a span, 'i' for an instant.
+  //A sketch can use it to show its own work, e.g. within the callback span. Does nothing unless Config::trace is set
+  void trace(EspalexaTracePoint p, char ph)
+  {
+    if (!Config::trace) return;
+    EspalexaTraceEvent& e = traceEvents[traceCount % Config::traceSize];
+    e.ts = micros();
+    e.point = p;
+    e.ph = ph;
+    traceCount++;
+  }
   
   //set whether Alexa can discover any devices
   void setDiscoverable(bool d)
@@ -601,13 +1586,127 @@ public:
     discoverable = d;
   }
   
-  //get EspalexaDevice at specific index
-  EspalexaDevice* getDevice(uint8_t index)
+  //get EspalexaDevice at specific index (id -1, so it continues into linked bridges), nullptr if the slot is empty
+  EspalexaDevice* getDevice(uint16_t index)
   {
+    if (index >= Config::maxDevices) return nextBridge != nullptr ? nextBridge->getDevice(index - Config::maxDevices) : nullptr;
     if (index >= currentDeviceCount) return nullptr;
     return devices[index];
   }
   
+  //binary snapshot of all devices changed after state version since (0 for all), e.g. to mirror the state to another MCU.
+  //Returns the bytes written, 0 if buf is too small. Pass the state version in bytes 4-7 as since for the next delta.
+  //since and the boot id are in the header too, so the importing side can tell whether a delta fits the state it has
+  size_t exportState(uint8_t* buf, size_t len, uint32_t since = 0)
+  {
+    if (len < ESPALEXA_STATE_HEADLEN) return 0;
+    //read first: a device changed while the loop runs is then exported again with the next delta instead of being skipped
+    uint32_t version = EspalexaDevice::getStateVersion();
+    size_t pos = ESPALEXA_STATE_HEADLEN;
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < currentDeviceCount; i++)
+    {
+      if (devices[i] == nullptr || devices[i]->getSequence() <= since) continue;
+      if (pos + 1 + ESPALEXA_STATE_RECLEN > len) return 0;
+      buf[pos] = i;
+      devices[i]->exportState(buf + pos + 1);
+      pos += 1 + ESPALEXA_STATE_RECLEN;
+      count++;
+    }
+    buf[0] = 'E'; buf[1] = 'S';
+    buf[2] = ESPALEXA_STATE_VERSION;
+    buf[3] = count;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+      buf[4+i] = (version >> (8*i)) & 0xFF;
+      buf[8+i] = (since >> (8*i)) & 0xFF;
+      buf[12+i] = (bootId >> (8*i)) & 0xFF;
+    }
+    return pos;
+  }
+
+  //applies a snapshot or delta from exportState(). Nothing is changed unless every record matches a device of the same type.
+  //A delta is only applied on top of the state of the same boot of the exporting side it was made for, after a reboot
+  //of either side or a lost delta this returns false until a full snapshot (since 0) was imported
+  bool importState(const uint8_t* buf, size_t len, bool callbacks = false)
+  {
+    if (len < ESPALEXA_STATE_HEADLEN || buf[0] != 'E' || buf[1] != 'S' || buf[2] != ESPALEXA_STATE_VERSION) return false;
+    if (len != ESPALEXA_STATE_HEADLEN + buf[3] * (size_t)(1 + ESPALEXA_STATE_RECLEN)) return false;
+    uint32_t version = 0, since = 0, boot = 0;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+      version |= (uint32_t)buf[4+i] << (8*i);
+      since |= (uint32_t)buf[8+i] << (8*i);
+      boot |= (uint32_t)buf[12+i] << (8*i);
+    }
+    if (since != 0 && (!importSynced || boot != importBoot || since > importVersion)) return false;
+    for (size_t pos = ESPALEXA_STATE_HEADLEN; pos < len; pos += 1 + ESPALEXA_STATE_RECLEN)
+    {
+      EspalexaDevice* d = (buf[pos] < currentDeviceCount) ? devices[buf[pos]] : nullptr; //slots of this bridge only
+      if (d == nullptr || (uint8_t)d->getType() != buf[pos+1]) return false;
+      if (buf[pos+4] > (uint8_t)EspalexaColorMode::xy) return false; //unknown color mode
+    }
+    for (size_t pos = ESPALEXA_STATE_HEADLEN; pos < len; pos += 1 + ESPALEXA_STATE_RECLEN)
+    {
+      EspalexaDevice* d = devices[buf[pos]];
+      d->importState(buf + pos + 1);
+      if (callbacks) d->doCallback();
+    }
+    importSynced = true;
+    importBoot = boot;
+    importVersion = version;
+    return true;
+  }
+
+  //true if loop() should be called again right away. An idle kept-alive connection or a subscriber that cannot take data is no pending work
+  bool hasPendingWork()
+  {
+    if (loopBusy) return true;
+    if (!Config::events) return false;
+    #ifdef ESPALEXA_ASYNC
+    if (eventSource != nullptr && eventCursor != queuedEventCount()) return true;
+    #else
+    for (uint8_t i = 0; i < Config::eventClients; i++)
+    {
+      if (eventCursors[i] != eventCount && !eventBlocked[i] && eventClients[i] && eventClients[i].connected()) return true;
+    }
+    #endif
+    return false;
+  }
+
+  //ms the sketch may wait (e.g. delay() in light sleep) before calling loop() again. Incoming requests queue up in the network stack meanwhile.
+  //Config::waitInterval while a connection or subscriber is open but has nothing to do, Config::idleInterval otherwise
+  uint32_t nextServiceIn()
+  {
+    if (hasPendingWork()) return 0;
+    return loopWaiting ? Config::waitInterval : Config::idleInterval;
+  }
+
+  //heap use statistics of a request type, or of loop() iterations for EspalexaRequestType::loop
+  const EspalexaHeapStats& getHeapStats(EspalexaRequestType t)
+  {
+    static_assert(Config::heapStats, "heap statistics are disabled, set heapStats in the config or define ESPALEXA_HEAP_STATS");
+    return heapStats[static_cast<uint8_t>(t)];
+  }
+
+  //count requests of a type that use more than bytes of heap in overBudget, 0 to disable
+  void setHeapBudget(EspalexaRequestType t, uint32_t bytes)
+  {
+    static_assert(Config::heapStats, "heap statistics are disabled, set heapStats in the config or define ESPALEXA_HEAP_STATS");
+    heapStats[static_cast<uint8_t>(t)].budget = bytes;
+  }
+
+  void resetHeapStats()
+  {
+    static_assert(Config::heapStats, "heap statistics are disabled, set heapStats in the config or define ESPALEXA_HEAP_STATS");
+    for (uint8_t i = 0; i < static_cast<uint8_t>(EspalexaRequestType::count); i++)
+    {
+      uint32_t budget = heapStats[i].budget;
+      heapStats[i] = EspalexaHeapStats();
+      heapStats[i].budget = budget;
+    }
+  }
+
   //is an unique device ID
   String getEscapedMac()
   {
@@ -621,7 +1720,9 @@ public:
     return perc / 255;
   }
   
-  ~Espalexa(){} //note: Espalexa is NOT meant to be destructed
+  ~EspalexaT(){} //note: Espalexa is NOT meant to be destructed
 };
 
+typedef EspalexaT<> Espalexa;
+
 #endif
@@ -2,6 +2,49 @@
 
 #include "EspalexaDevice.h"
 
+//dimming curves, 16 bit output for each brightness value (0-255)
+//CIE 1931 lightness: Y = L/903.3 for L <= 8, else ((L+16)/116)^3, with L = 100*bri/255
+static const uint16_t _curve_cie1931[256] PROGMEM = {
+  0,28,57,85,114,142,171,199,228,256,285,313,341,370,398,427,
+  455,484,512,541,569,598,627,658,689,721,755,789,825,861,899,937,
+  977,1018,1060,1103,1147,1192,1239,1287,1336,1386,1437,1490,1544,1599,1656,1714,
+  1773,1834,1896,1959,2024,2090,2157,2226,2297,2369,2442,2517,2593,2671,2751,2832,
+  2914,2999,3085,3172,3261,3352,3444,3538,3634,3732,3831,3932,4035,4139,4245,4354,
+  4464,4575,4689,4804,4922,5041,5162,5285,5410,5537,5666,5797,5930,6065,6202,6341,
+  6482,6626,6771,6918,7068,7220,7373,7529,7687,7848,8010,8175,8342,8512,8683,8857,
+  9033,9212,9393,9576,9762,9949,10140,10333,10528,10725,10926,11128,11333,11541,11751,11963,
+  12179,12396,12617,12840,13065,13293,13524,13757,13993,14232,14474,14718,14965,15215,15467,15722,
+  15980,16241,16505,16771,17041,17313,17588,17866,18147,18431,18717,19007,19300,19596,19894,20196,
+  20501,20809,21119,21433,21750,22071,22394,22720,23050,23383,23719,24058,24400,24746,25095,25447,
+  25802,26161,26523,26888,27257,27629,28004,28383,28765,29151,29540,29932,30328,30728,31131,31537,
+  31947,32360,32777,33198,33622,34050,34481,34916,35355,35797,36243,36693,37146,37603,38064,38529,
+  38997,39469,39945,40425,40908,41396,41887,42382,42881,43384,43891,44401,44916,45435,45957,46484,
+  47015,47549,48088,48631,49178,49728,50283,50843,51406,51973,52545,53120,53700,54284,54873,55465,
+  56062,56663,57269,57878,58492,59111,59733,60360,60992,61627,62268,62912,63561,64215,64873,65535
+};
+
+//gamma 2.2: Y = (bri/255)^2.2
+static const uint16_t _curve_gamma22[256] PROGMEM = {
+  0,0,2,4,7,11,17,24,32,42,53,65,79,94,111,129,
+  148,169,192,216,242,270,299,330,362,396,432,469,508,549,591,635,
+  681,729,779,830,883,938,995,1053,1113,1175,1239,1305,1373,1443,1514,1587,
+  1663,1740,1819,1900,1983,2068,2155,2243,2334,2427,2521,2618,2717,2817,2920,3024,
+  3131,3240,3350,3463,3578,3694,3813,3934,4057,4182,4309,4438,4570,4703,4838,4976,
+  5115,5257,5401,5547,5695,5845,5998,6152,6309,6468,6629,6792,6957,7124,7294,7466,
+  7640,7816,7994,8175,8358,8543,8730,8919,9111,9305,9501,9699,9900,10102,10307,10515,
+  10724,10936,11150,11366,11585,11806,12029,12254,12482,12712,12944,13179,13416,13655,13896,14140,
+  14386,14635,14885,15138,15394,15652,15912,16174,16439,16706,16975,17247,17521,17798,18077,18358,
+  18642,18928,19216,19507,19800,20095,20393,20694,20996,21301,21609,21919,22231,22546,22863,23182,
+  23504,23829,24156,24485,24817,25151,25487,25826,26168,26512,26858,27207,27558,27912,28268,28627,
+  28988,29351,29717,30086,30457,30830,31206,31585,31966,32349,32735,33124,33514,33908,34304,34702,
+  35103,35507,35913,36321,36732,37146,37562,37981,38402,38825,39252,39680,40112,40546,40982,41421,
+  41862,42306,42753,43202,43654,44108,44565,45025,45487,45951,46418,46888,47360,47835,48313,48793,
+  49275,49761,50249,50739,51232,51728,52226,52727,53230,53736,54245,54756,55270,55787,56306,56828,
+  57352,57879,58409,58941,59476,60014,60554,61097,61642,62190,62741,63295,63851,64410,64971,65535
+};
+
+uint32_t EspalexaDevice::_stateVersion = 0;
+
 EspalexaDevice::EspalexaDevice(){}
 
 EspalexaDevice::EspalexaDevice(String deviceName, BrightnessCallbackFunction gnCallback, uint8_t initialValue) { //constructor for dimmable device
@@ -32,13 +75,61 @@ EspalexaDevice::EspalexaDevice(String deviceName, DeviceCallbackFunction gnCallb
   _val_last = _val;
 }
 
+//constructors for devices named from PROGMEM, the name is never copied to RAM
+EspalexaDevice::EspalexaDevice(const __FlashStringHelper* deviceName, BrightnessCallbackFunction gnCallback, uint8_t initialValue)
+  : EspalexaDevice(String(), gnCallback, initialValue)
+{
+  _deviceNameP = deviceName;
+}
+
+EspalexaDevice::EspalexaDevice(const __FlashStringHelper* deviceName, ColorCallbackFunction gnCallback, uint8_t initialValue)
+  : EspalexaDevice(String(), gnCallback, initialValue)
+{
+  _deviceNameP = deviceName;
+}
+
+EspalexaDevice::EspalexaDevice(const __FlashStringHelper* deviceName, DeviceCallbackFunction gnCallback, EspalexaDeviceType t, uint8_t initialValue)
+  : EspalexaDevice(String(), gnCallback, t, initialValue)
+{
+  _deviceNameP = deviceName;
+}
+
 EspalexaDevice::~EspalexaDevice(){/*nothing to destruct*/}
 
+//little endian helpers for the binary state record
+static void putU16(uint8_t* p, uint16_t v)
+{
+  p[0] = v & 0xFF; p[1] = v >> 8;
+}
+
+static uint16_t getU16(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static void putF32(uint8_t* p, float f)
+{
+  uint32_t v; memcpy(&v, &f, 4);
+  p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = v >> 24;
+}
+
+static float getF32(const uint8_t* p)
+{
+  uint32_t v = p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  float f; memcpy(&f, &v, 4);
+  return f;
+}
+
 uint8_t EspalexaDevice::getId()
 {
   return _id;
 }
 
+uint16_t EspalexaDevice::getGlobalId()
+{
+  return _idBase + _id;
+}
+
 EspalexaColorMode EspalexaDevice::getColorMode()
 {
   return _mode;
@@ -51,9 +142,38 @@ EspalexaDeviceType EspalexaDevice::getType()
 
 String EspalexaDevice::getName()
 {
+  if (_deviceNameP != nullptr) return String(_deviceNameP);
   return _deviceName;
 }
 
+size_t EspalexaDevice::getName(char* buf, size_t len)
+{
+  if (len == 0) return 0;
+  if (_deviceNameP != nullptr)
+  {
+    strncpy_P(buf, (const char*)_deviceNameP, len);
+  } else {
+    strncpy(buf, _deviceName.c_str(), len);
+  }
+  buf[len-1] = 0;
+  return strlen(buf);
+}
+
+uint32_t EspalexaDevice::getStateVersion()
+{
+  return _stateVersion;
+}
+
+uint32_t EspalexaDevice::getSequence()
+{
+  return _seq;
+}
+
+void EspalexaDevice::markStateChanged()
+{
+  _stateVersion++;
+}
+
 EspalexaDeviceProperty EspalexaDevice::getLastChangedProperty()
 {
   return _changed;
@@ -80,6 +200,24 @@ uint8_t EspalexaDevice::getDegrees()
   return getPercent();
 }
 
+EspalexaDimmingCurve EspalexaDevice::getDimmingCurve()
+{
+  return _curve;
+}
+
+uint16_t EspalexaDevice::getOutput()
+{
+  if (_curveTable == nullptr) return _val * 257;
+  return pgm_read_word(&_curveTable[_val]);
+}
+
+uint16_t EspalexaDevice::getOutput(uint8_t bits)
+{
+  if (bits == 0 || bits > 16) bits = 16;
+  uint32_t max = (1UL << bits) -1;
+  return (getOutput() * max + 32767) / 65535;
+}
+
 uint16_t EspalexaDevice::getHue()
 {
   return _hue;
@@ -257,15 +395,19 @@ void EspalexaDevice::setPropertyChanged(EspalexaDeviceProperty p)
   _changed = p;
 }
 
-void EspalexaDevice::setId(uint8_t id)
+void EspalexaDevice::setId(uint8_t id, uint16_t idBase)
 {
   _id = id;
+  _idBase = idBase;
+  _seq = ++_stateVersion;
 }
 
 //you need to re-discover the device for the Alexa name to change
 void EspalexaDevice::setName(String name)
 {
   _deviceName = name;
+  _deviceNameP = nullptr;
+  _seq = ++_stateVersion;
 }
 
 void EspalexaDevice::setValue(uint8_t val)
@@ -279,6 +421,7 @@ void EspalexaDevice::setValue(uint8_t val)
     _val_last = val;
   }
   _val = val;
+  _seq = ++_stateVersion;
 }
 
 void EspalexaDevice::setState(bool onoff)
@@ -305,6 +448,7 @@ void EspalexaDevice::setColorXY(float x, float y)
   _y = y;
   _rgb = 0;
   _mode = EspalexaColorMode::xy;
+  _seq = ++_stateVersion;
 }
 
 void EspalexaDevice::setColor(uint16_t hue, uint8_t sat)
@@ -313,6 +457,7 @@ void EspalexaDevice::setColor(uint16_t hue, uint8_t sat)
   _sat = sat;
   _rgb = 0;
   _mode = EspalexaColorMode::hs;
+  _seq = ++_stateVersion;
 }
 
 void EspalexaDevice::setColor(uint16_t ct)
@@ -320,6 +465,7 @@ void EspalexaDevice::setColor(uint16_t ct)
   _ct = ct;
   _rgb = 0;
   _mode =EspalexaColorMode::ct;
+  _seq = ++_stateVersion;
 }
 
 void EspalexaDevice::setColor(uint8_t r, uint8_t g, uint8_t b)
@@ -331,6 +477,51 @@ void EspalexaDevice::setColor(uint8_t r, uint8_t g, uint8_t b)
   _y = Y / (X + Y + Z);
   _rgb = ((r << 16) | (g << 8) | b);
   _mode = EspalexaColorMode::xy;
+  _seq = ++_stateVersion;
+}
+
+void EspalexaDevice::setDimmingCurve(EspalexaDimmingCurve curve, const uint16_t* table)
+{
+  _curve = curve;
+  switch (curve)
+  {
+    case EspalexaDimmingCurve::cie1931: _curveTable = _curve_cie1931; break;
+    case EspalexaDimmingCurve::gamma22: _curveTable = _curve_gamma22; break;
+    case EspalexaDimmingCurve::custom:  _curveTable = table; break;
+    default: _curveTable = nullptr;
+  }
+  if (_curveTable == nullptr) _curve = EspalexaDimmingCurve::linear;
+}
+
+//record layout: type, val, val_last, mode, sat, hue (u16), ct (u16), x (f32), y (f32), rgb (u24), little endian.
+//rgb is the cached color (0 if not computed yet), so a color set with setColor(r,g,b) is not recomputed from x and y
+void EspalexaDevice::exportState(uint8_t* out)
+{
+  out[0] = (uint8_t)_type;
+  out[1] = _val;
+  out[2] = _val_last;
+  out[3] = (uint8_t)_mode;
+  out[4] = _sat;
+  putU16(out +5, _hue);
+  putU16(out +7, _ct);
+  putF32(out +9, _x);
+  putF32(out +13, _y);
+  out[17] = _rgb & 0xFF; out[18] = (_rgb >> 8) & 0xFF; out[19] = (_rgb >> 16) & 0xFF;
+}
+
+//the type byte is not applied, the caller checks that it matches
+void EspalexaDevice::importState(const uint8_t* in)
+{
+  _val = in[1];
+  _val_last = in[2];
+  _mode = (EspalexaColorMode)in[3];
+  _sat = in[4];
+  _hue = getU16(in +5);
+  _ct = getU16(in +7);
+  _x = getF32(in +9);
+  _y = getF32(in +13);
+  _rgb = in[17] | (in[18] << 8) | ((uint32_t)in[19] << 16);
+  _seq = ++_stateVersion;
 }
 
 void EspalexaDevice::doCallback()
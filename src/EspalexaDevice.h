@@ -4,6 +4,9 @@
 #include "Arduino.h"
 #include <functional>
 
+#define ESPALEXA_NAME_MAXLEN 128 //longest device name in Hue API responses
+#define ESPALEXA_STATE_RECLEN 20 //bytes of one device in exportState()
+
 class EspalexaDevice;
 
 typedef std::function<void(uint8_t b)> BrightnessCallbackFunction;
@@ -13,10 +16,12 @@ typedef std::function<void(uint8_t br, uint32_t col)> ColorCallbackFunction;
 enum class EspalexaColorMode : uint8_t { none = 0, ct = 1, hs = 2, xy = 3 };
 enum class EspalexaDeviceType : uint8_t { onoff = 0, dimmable = 1, whitespectrum = 2, color = 3, extendedcolor = 4 };
 enum class EspalexaDeviceProperty : uint8_t { none = 0, on = 1, off = 2, bri = 3, hs = 4, ct = 5, xy = 6 };
+enum class EspalexaDimmingCurve : uint8_t { linear = 0, cie1931 = 1, gamma22 = 2, custom = 3 };
 
 class EspalexaDevice {
 private:
   String _deviceName;
+  const __FlashStringHelper* _deviceNameP = nullptr; //name in PROGMEM, avoids the heap copy in _deviceName
   BrightnessCallbackFunction _callback = nullptr;
   DeviceCallbackFunction _callbackDev = nullptr;
   ColorCallbackFunction _callbackCol = nullptr;
@@ -25,9 +30,14 @@ private:
   float _x = 0.5, _y = 0.5;
   uint32_t _rgb = 0;
   uint8_t _id = 0;
+  uint16_t _idBase = 0; //slots of the linked bridges before the one holding this device
   EspalexaDeviceType _type;
   EspalexaDeviceProperty _changed = EspalexaDeviceProperty::none;
   EspalexaColorMode _mode = EspalexaColorMode::xy;
+  EspalexaDimmingCurve _curve = EspalexaDimmingCurve::linear;
+  const uint16_t* _curveTable = nullptr; //256 output values, nullptr for linear
+  uint32_t _seq = 0; //value of _stateVersion at the last change of this device
+  static uint32_t _stateVersion; //changes whenever any device changes
   
 public:
   EspalexaDevice();
@@ -35,9 +45,14 @@ public:
   EspalexaDevice(String deviceName, BrightnessCallbackFunction bcb, uint8_t initialValue =0);
   EspalexaDevice(String deviceName, DeviceCallbackFunction dcb, EspalexaDeviceType t =EspalexaDeviceType::dimmable, uint8_t initialValue =0);
   EspalexaDevice(String deviceName, ColorCallbackFunction ccb, uint8_t initialValue =0);
+  EspalexaDevice(const __FlashStringHelper* deviceName, BrightnessCallbackFunction bcb, uint8_t initialValue =0);
+  EspalexaDevice(const __FlashStringHelper* deviceName, DeviceCallbackFunction dcb, EspalexaDeviceType t =EspalexaDeviceType::dimmable, uint8_t initialValue =0);
+  EspalexaDevice(const __FlashStringHelper* deviceName, ColorCallbackFunction ccb, uint8_t initialValue =0);
   
   String getName();
-  uint8_t getId();
+  size_t getName(char* buf, size_t len); //copies the name without creating a String, returns its length
+  uint8_t getId(); //slot on the bridge holding the device
+  uint16_t getGlobalId(); //slot counted over all linked bridges, getGlobalId()+1 is the id returned by addDevice()
   EspalexaDeviceProperty getLastChangedProperty();
   uint8_t getValue();
   uint8_t getLastValue(); //last value that was not off (1-255)
@@ -57,8 +72,14 @@ public:
   uint8_t getW();
   EspalexaColorMode getColorMode();
   EspalexaDeviceType getType();
+  EspalexaDimmingCurve getDimmingCurve();
+  uint16_t getOutput(); //brightness after the dimming curve, 0-65535
+  uint16_t getOutput(uint8_t bits); //same, scaled to a PWM resolution of bits (1-16)
+  uint32_t getSequence(); //state version of the last change to this device
+  static uint32_t getStateVersion();
+  static void markStateChanged();
   
-  void setId(uint8_t id);
+  void setId(uint8_t id, uint16_t idBase = 0);
   void setPropertyChanged(EspalexaDeviceProperty p);
   void setValue(uint8_t bri);
   void setState(bool onoff);
@@ -68,6 +89,10 @@ public:
   void setColor(uint16_t hue, uint8_t sat);
   void setColorXY(float x, float y);
   void setColor(uint8_t r, uint8_t g, uint8_t b);
+  void setDimmingCurve(EspalexaDimmingCurve curve, const uint16_t* table = nullptr); //table (custom curve only): 256 values in RAM or PROGMEM
+  
+  void exportState(uint8_t* out); //writes ESPALEXA_STATE_RECLEN bytes
+  void importState(const uint8_t* in); //reads a record written by exportState()
   
   void doCallback();
 };
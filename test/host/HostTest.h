@@ -0,0 +1,63 @@
+//Helpers shared by the host tests
+#ifndef HostTest_h
+#define HostTest_h
+
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+static int testFailures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+  fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); testFailures++; } } while (0)
+
+#define CHECK_EQ(a, b) do { auto va_ = (a); auto vb_ = (b); if (!(va_ == vb_)) { \
+  fprintf(stderr, "%s:%d: check failed: %s == %s\n  got:      %s\n  expected: %s\n", __FILE__, __LINE__, #a, #b, \
+  testString(va_).c_str(), testString(vb_).c_str()); testFailures++; } } while (0)
+
+inline std::string testString(const std::string& s) { return s; }
+inline std::string testString(const String& s) { return s.c_str(); }
+inline std::string testString(const char* s) { return s ? s : "(null)"; }
+template <typename T> std::string testString(T v) { return std::to_string(v); }
+
+//prints the result line and returns the exit code for main()
+inline int testResult(const char* name)
+{
+  printf("%s: %s\n", name, testFailures ? "FAILED" : "ok");
+  return testFailures ? 1 : 0;
+}
+
+//wall clock time in ns per call of fn, for benchmarks
+template <typename F>
+double benchNs(uint32_t iterations, F fn)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) fn(i);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+inline double percentile(std::vector<double> v, double p)
+{
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  size_t i = (size_t)(p / 100.0 * (v.size() - 1) + 0.5);
+  return v[i];
+}
+
+//JSON key of the light in slot of the first bridge, as encodeLightKey() builds it from the mocked MAC
+inline int lightKey(uint8_t slot)
+{
+  uint32_t mac24 = ((uint32_t)WiFi.mac[3] << 16) | ((uint32_t)WiFi.mac[4] << 8) | WiFi.mac[5];
+  return (mac24 << 7) | slot;
+}
+
+inline std::string lightUrl(uint8_t slot)
+{
+  return "/api/user/lights/" + std::to_string(lightKey(slot));
+}
+
+#endif
@@ -0,0 +1,211 @@
+//Replays traffic captured with ESPALEXA_RECORD on the simulated clock, the way a sketch sees it: loop() is called,
+//then the sketch sleeps nextServiceIn() ms, and requests arrive at their recorded times.
+//HTTP records are queued on the server and served by loop(), UDP records go to handleUdpPacket() with the replies written to a buffer.
+//Besides the records Espalexa writes, a capture may contain records for the replayer:
+//  #EA 0 DEVICE <type> <length>   adds a device of EspalexaDeviceType <type> named by the payload, unless one of that name exists
+//  #EA <ms> EXPECT <n> <length>  checks the record before it: HTTP status n or n SSDP replies, and the payload is part of the response
+//Lines before a record that do not start with "#EA " are comments.
+#ifndef Replay_h
+#define Replay_h
+
+#include "HostTest.h"
+#include <fstream>
+#include <sstream>
+
+struct ReplayRecord {
+  uint32_t ms = 0;
+  std::string kind, path, data;
+  int expect = -1; //status or number of replies, -1 if not checked
+  std::string expectText;
+};
+
+//parses a capture, returns false with the reason in error if it is malformed
+inline bool parseCapture(const std::string& text, std::vector<ReplayRecord>& records, std::string& error)
+{
+  size_t pos = 0;
+  while ((pos = text.find("#EA ", pos)) != std::string::npos)
+  {
+    if (pos > 0 && text[pos - 1] != '\n') { pos += 4; continue; }
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) { error = "record header without newline"; return false; }
+    ReplayRecord r;
+    char kind[16], path[256];
+    unsigned long len;
+    if (sscanf(text.substr(pos, eol - pos).c_str(), "#EA %u %15s %255s %lu", &r.ms, kind, path, &len) != 4 ||
+        eol + 1 + len > text.size())
+    {
+      error = "bad record header: " + text.substr(pos, eol - pos);
+      return false;
+    }
+    r.kind = kind;
+    r.path = path;
+    r.data = text.substr(eol + 1, len);
+    pos = eol + 1 + len;
+    if (r.kind == "EXPECT")
+    {
+      if (records.empty()) { error = "EXPECT without a record before it"; return false; }
+      records.back().expect = atoi(path);
+      records.back().expectText = r.data;
+      continue;
+    }
+    records.push_back(r);
+  }
+  return true;
+}
+
+inline bool loadCapture(const std::string& file, std::vector<ReplayRecord>& records, std::string& error)
+{
+  std::ifstream in(file, std::ios::binary);
+  if (!in) { error = "cannot open " + file; return false; }
+  std::stringstream s;
+  s << in.rdbuf();
+  return parseCapture(s.str(), records, error);
+}
+
+//SSDP replies of a replayed datagram
+class ReplyBuffer : public Print {
+public:
+  std::string data;
+  size_t write(uint8_t c) override { data.push_back(c); return 1; }
+  size_t write(const uint8_t* buf, size_t len) override { data.append((const char*)buf, len); return len; }
+  using Print::write;
+};
+
+template <class E>
+class Replayer {
+public:
+  struct Result {
+    uint32_t http = 0, udp = 0, failures = 0;
+    std::vector<double> waitMs;    //simulated time from arrival of an HTTP request until loop() served it
+    std::vector<uint32_t> ahead;   //HTTP requests queued before it and not yet served when it arrived
+    std::vector<double> serviceUs; //wall time of handling a request or datagram
+    uint32_t heapPeak = 0;         //most heap used by a request, in bytes
+    uint32_t heapAfter = 0;        //heap used when the replay ended
+  };
+
+  Replayer(E& espalexa, ESP8266WebServer* server) : espalexa(espalexa), server(server)
+  {
+    body.reserve(64 * 1024);
+    replies.data.reserve(16 * 1024);
+  }
+
+  //name is used in failure messages
+  Result run(const std::vector<ReplayRecord>& records, const std::string& name)
+  {
+    Result res;
+    for (auto& r : records) if (r.kind == "DEVICE") addDevice(r);
+
+    //responses are checked as the mock server sends them, without allocating, so the heap of a request is its own
+    std::vector<size_t> queued;
+    queued.reserve(records.size());
+    res.ahead.reserve(records.size());
+    size_t served = 0;
+    server->keepResponses = false;
+    server->bodySink = &body;
+    server->onResponse = [&](const ESP8266WebServer::Response& resp) {
+      if (served >= queued.size()) return;
+      const ReplayRecord& r = records[queued[served]];
+      check(res, name, r, resp.code, body);
+      res.waitMs.push_back((resp.servedAt - resp.queuedAt) / 1000.0);
+      body.clear();
+      served++;
+    };
+    res.waitMs.reserve(records.size());
+    res.serviceUs.reserve(records.size());
+
+    uint64_t start = host::now();
+    uint64_t wake = start;
+    size_t next = 0;
+    uint32_t idleLoops = 0;
+    while (next < records.size() || served < queued.size())
+    {
+      for (; next < records.size() && start + records[next].ms * (uint64_t)1000 <= wake; next++)
+      {
+        const ReplayRecord& r = records[next];
+        host::setTime(std::max(host::now(), start + r.ms * (uint64_t)1000));
+        if (r.kind == "HTTP")
+        {
+          HTTPMethod method = r.data.empty() ? HTTP_GET : (r.data.find("devicetype") != std::string::npos ? HTTP_POST : HTTP_PUT);
+          server->queue(method, r.path, r.data);
+          res.ahead.push_back(queued.size() - served);
+          queued.push_back(next);
+          res.http++;
+        }
+        else if (r.kind == "UDP")
+        {
+          replies.data.clear();
+          uint32_t heap = host::heapUsed();
+          host::resetHeapPeak();
+          auto t = std::chrono::steady_clock::now();
+          espalexa.handleUdpPacket(r.data.c_str(), &replies);
+          res.serviceUs.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count());
+          res.heapPeak = std::max(res.heapPeak, host::heapPeak() - heap);
+          size_t n = 0;
+          for (size_t p = replies.data.find("HTTP/1.1 200 OK"); p != std::string::npos; p = replies.data.find("HTTP/1.1 200 OK", p + 1)) n++;
+          check(res, name, r, (int)n, replies.data);
+          res.udp++;
+        }
+      }
+      host::setTime(std::max(host::now(), wake));
+
+      size_t servedBefore = served;
+      uint32_t heap = host::heapUsed();
+      host::resetHeapPeak();
+      auto t = std::chrono::steady_clock::now();
+      espalexa.loop();
+      double loopUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count();
+      if (served > servedBefore)
+      {
+        for (size_t i = servedBefore; i < served; i++) res.serviceUs.push_back(loopUs / (served - servedBefore));
+        res.heapPeak = std::max(res.heapPeak, host::heapPeak() - heap);
+        idleLoops = 0;
+      }
+      else if (served < queued.size() && ++idleLoops > 1000)
+      {
+        fprintf(stderr, "%s: %u requests never served\n", name.c_str(), (unsigned)(queued.size() - served));
+        res.failures++;
+        break;
+      }
+      wake = host::now() + espalexa.nextServiceIn() * (uint64_t)1000;
+    }
+    server->onResponse = nullptr;
+    server->bodySink = nullptr;
+    server->keepResponses = true;
+    res.heapAfter = host::heapUsed();
+    return res;
+  }
+
+private:
+  E& espalexa;
+  ESP8266WebServer* server;
+  std::string body;
+  ReplyBuffer replies;
+
+  static void changed(EspalexaDevice*) {}
+
+  void addDevice(const ReplayRecord& r)
+  {
+    for (uint16_t i = 0; i < 128; i++)
+    {
+      EspalexaDevice* d = espalexa.getDevice(i);
+      if (d != nullptr && d->getName() == r.data.c_str()) return;
+    }
+    const char* types[] = {"onoff", "dimmable", "whitespectrum", "color", "extendedcolor"};
+    uint8_t t = 0;
+    while (t < 5 && r.path != types[t]) t++;
+    espalexa.addDevice(r.data.c_str(), changed, (EspalexaDeviceType)(t < 5 ? t : 1));
+  }
+
+  void check(Result& res, const std::string& name, const ReplayRecord& r, int got, const std::string& response)
+  {
+    if (r.expect < 0) return;
+    if (got != r.expect || response.find(r.expectText) == std::string::npos)
+    {
+      fprintf(stderr, "%s: %s %s at %u ms: expected %d with \"%s\", got %d: %.200s\n", name.c_str(), r.kind.c_str(), r.path.c_str(),
+        r.ms, r.expect, r.expectText.c_str(), got, response.c_str());
+      res.failures++;
+    }
+  }
+};
+
+#endif
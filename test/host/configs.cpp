@@ -0,0 +1,68 @@
+//Builds the public API in every supported configuration, see the configs target in the Makefile
+#include <Espalexa.h>
+
+Espalexa espalexa;
+Espalexa bridge2;
+
+void changed(uint8_t) {}
+void changedDev(EspalexaDevice*) {}
+void changedCol(uint8_t, uint32_t) {}
+
+const char alphaName[] PROGMEM = "Alpha";
+EspalexaDevice table[] = { {FPSTR(alphaName), changedDev, EspalexaDeviceType::onoff}, {F("Beta"), changed, 3}, {"Gamma", changedCol} };
+
+struct MinimalConfig : EspalexaDefaultConfig {
+  static const uint8_t maxDevices = 2;
+  static const bool statusPage = false;
+  static const bool colorSupport = false;
+};
+EspalexaT<MinimalConfig> minimal;
+
+//opt-in features enabled per instance, whatever the defines say
+struct FullConfig : EspalexaDefaultConfig {
+  static const bool debug = true;
+  static const bool record = true;
+  static const bool heapStats = true;
+  static const bool trace = true;
+  static const uint16_t traceSize = 16;
+  static const bool events = true;
+  static const uint8_t httpMaxClients = 3;
+};
+EspalexaT<FullConfig> full;
+
+void setup()
+{
+  espalexa.addDevices(table);
+  espalexa.addDevice("a", changed);
+  espalexa.addDevice("b", changedDev, EspalexaDeviceType::color);
+  espalexa.addDevice("c", changedCol);
+  bridge2.setBridge(1, 8081);
+  espalexa.linkBridge(&bridge2);
+  espalexa.begin();
+  bridge2.begin();
+  espalexa.renameDevice(1, "A");
+  espalexa.replaceDevice(1, &table[0]);
+  espalexa.removeDevice(2);
+  espalexa.getDevice(0)->setDimmingCurve(EspalexaDimmingCurve::cie1931);
+  uint8_t buf[64];
+  size_t n = espalexa.exportState(buf, sizeof(buf));
+  espalexa.importState(buf, n);
+  #ifndef ESPALEXA_ASYNC
+  espalexa.handleAlexaApiCall(String("/api"), String(""));
+  #endif
+  minimal.addDevice("a", changed);
+  minimal.begin();
+  full.setBridge(2, 8082);
+  full.addDevice("f", changedDev, EspalexaDeviceType::extendedcolor);
+  full.begin();
+  full.setHeapBudget(EspalexaRequestType::lights, 1024);
+}
+
+void loop()
+{
+  espalexa.loop();
+  bridge2.loop();
+  minimal.loop();
+  full.loop();
+  delay(espalexa.nextServiceIn());
+}
@@ -0,0 +1,218 @@
+//Minimal Arduino core for building Espalexa on a Linux host (tests and the POSIX backend)
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+#include <string>
+#include <functional>
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper*>(p))
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcat_P strcat
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define pgm_read_ptr(p) (*(void* const*)(p))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+class String {
+  std::string s;
+public:
+  String() {}
+  String(const char* c) : s(c ? c : "") {}
+  String(const __FlashStringHelper* c) : s(c ? (const char*)c : "") {}
+  String(const std::string& c) : s(c) {}
+  explicit String(char c) : s(1, c) {}
+  explicit String(unsigned char v) : s(std::to_string(v)) {}
+  explicit String(int v) : s(std::to_string(v)) {}
+  explicit String(unsigned int v) : s(std::to_string(v)) {}
+  explicit String(long v) : s(std::to_string(v)) {}
+  explicit String(unsigned long v) : s(std::to_string(v)) {}
+  explicit String(float v, unsigned char decimals = 2) { fromDouble(v, decimals); }
+  explicit String(double v, unsigned char decimals = 2) { fromDouble(v, decimals); }
+
+  const char* c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.size(); }
+  bool isEmpty() const { return s.empty(); }
+  bool reserve(unsigned int n) { s.reserve(n); return true; }
+  char charAt(unsigned int i) const { return i < s.size() ? s[i] : 0; }
+  char operator[](unsigned int i) const { return charAt(i); }
+
+  int indexOf(char c, unsigned int from = 0) const { return pos(s.find(c, from)); }
+  int indexOf(const char* c, unsigned int from = 0) const { return pos(s.find(c, from)); }
+  int indexOf(const String& c, unsigned int from = 0) const { return pos(s.find(c.s, from)); }
+  int lastIndexOf(char c) const { return pos(s.rfind(c)); }
+  String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const { return (from < s.size() && to > from) ? String(s.substr(from, to - from)) : String(); }
+  bool startsWith(const String& o) const { return s.compare(0, o.s.size(), o.s) == 0; }
+  bool endsWith(const String& o) const { return s.size() >= o.s.size() && s.compare(s.size() - o.s.size(), o.s.size(), o.s) == 0; }
+  long toInt() const { return atol(s.c_str()); }
+  float toFloat() const { return atof(s.c_str()); }
+  void toLowerCase() { for (auto& c : s) c = tolower(c); }
+  void toUpperCase() { for (auto& c : s) c = toupper(c); }
+
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* o) const { return s == (o ? o : ""); }
+  bool operator!=(const String& o) const { return s != o.s; }
+  bool operator!=(const char* o) const { return !(*this == o); }
+  String& operator+=(const String& o) { s += o.s; return *this; }
+  String& operator+=(const char* o) { if (o) s += o; return *this; }
+  String& operator+=(const __FlashStringHelper* o) { return *this += (const char*)o; }
+  String& operator+=(char c) { s += c; return *this; }
+  String& operator+=(int v) { s += std::to_string(v); return *this; }
+  String& operator+=(unsigned int v) { s += std::to_string(v); return *this; }
+  String& operator+=(long v) { s += std::to_string(v); return *this; }
+  String& operator+=(unsigned long v) { s += std::to_string(v); return *this; }
+  friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+  friend String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+  friend String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+
+private:
+  static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+  void fromDouble(double v, unsigned char decimals)
+  {
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    s = buf;
+  }
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len)
+  {
+    size_t n = 0;
+    while (len--) n += write(*buf++);
+    return n;
+  }
+  size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t write(const char* buf, size_t len) { return write((const uint8_t*)buf, len); }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v) { return printf("%u", v); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned int v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(double v) { return printf("%.2f", v); }
+  template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  size_t println() { return write("\r\n"); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)))
+  {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+};
+
+//Serial writes to stdout, or appends to a string while capture is set
+class HostSerial : public Stream {
+public:
+  std::string* capture = nullptr;
+  void begin(unsigned long) {}
+  using Print::write;
+  size_t write(uint8_t c) override
+  {
+    if (capture) capture->push_back(c); else putchar(c);
+    return 1;
+  }
+  size_t write(const uint8_t* buf, size_t len) override
+  {
+    if (capture) capture->append((const char*)buf, len); else fwrite(buf, 1, len, stdout);
+    return len;
+  }
+};
+extern HostSerial Serial;
+
+class IPAddress {
+  uint8_t b[4] = {0, 0, 0, 0};
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t c, uint8_t d, uint8_t e) { b[0] = a; b[1] = c; b[2] = d; b[3] = e; }
+  IPAddress(uint32_t v) { memcpy(b, &v, 4); } //network byte order, like the ESP cores
+  uint8_t operator[](int i) const { return b[i]; }
+  uint8_t& operator[](int i) { return b[i]; }
+  operator uint32_t() const { uint32_t v; memcpy(&v, b, 4); return v; }
+  bool operator==(const IPAddress& o) const { return memcmp(b, o.b, 4) == 0; }
+  bool operator!=(const IPAddress& o) const { return !(*this == o); }
+  String toString() const
+  {
+    char s[16];
+    sprintf(s, "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+    return s;
+  }
+};
+
+struct EspClass {
+  uint32_t getFreeHeap();
+  uint32_t getMaxFreeBlockSize() { return getFreeHeap(); }
+  uint32_t getCycleCount() { return micros() * 80; }
+};
+extern EspClass ESP;
+
+#ifdef ARDUINO_ARCH_ESP32
+//FreeRTOS spinlock, a mutex on the host
+struct portMUX_TYPE { void* lock; };
+#define portMUX_INITIALIZER_UNLOCKED {nullptr}
+void hostEnterCritical(portMUX_TYPE* m);
+void hostExitCritical(portMUX_TYPE* m);
+#define portENTER_CRITICAL(m) hostEnterCritical(m)
+#define portEXIT_CRITICAL(m) hostExitCritical(m)
+#endif
+
+//host interface of the test core in host.cpp, not part of the Arduino API. The POSIX backend does not have it
+namespace host {
+  void setRealTime(bool real);     //millis()/micros() follow the system clock instead of the simulated one
+  void setTime(uint64_t us);       //simulated clock
+  void advance(uint64_t us);
+  uint64_t now();                  //simulated or real time in us
+
+  //every operator new/delete is counted, ESP.getFreeHeap() is heapSize - heapUsed()
+  const uint32_t heapSize = 81920;
+  uint32_t heapUsed();
+  uint32_t heapPeak();             //largest heapUsed() since the last resetHeapPeak()
+  void resetHeapPeak();
+  uint64_t allocations();          //number of allocations since start
+}
+
+#endif
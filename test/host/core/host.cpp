@@ -0,0 +1,86 @@
+//Host implementation of the Arduino core functions declared in Arduino.h
+#include "Arduino.h"
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <new>
+#include <atomic>
+
+HostSerial Serial;
+EspClass ESP;
+
+static bool realTime = false;
+static uint64_t simTime = 0;
+static const auto startTime = std::chrono::steady_clock::now();
+
+namespace host {
+  void setRealTime(bool real) { realTime = real; }
+  void setTime(uint64_t us) { simTime = us; }
+  void advance(uint64_t us) { simTime += us; }
+  uint64_t now()
+  {
+    if (!realTime) return simTime;
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+  }
+}
+
+unsigned long millis() { return host::now() / 1000; }
+unsigned long micros() { return host::now(); }
+void yield() {}
+
+void delay(unsigned long ms)
+{
+  if (realTime) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  else simTime += (uint64_t)ms * 1000;
+}
+
+#ifndef ARDUINO_ARCH_ESP32
+struct portMUX_TYPE; //declared in Arduino.h for ESP32 tests only
+#endif
+static std::recursive_mutex criticalMutex;
+void hostEnterCritical(portMUX_TYPE*) { criticalMutex.lock(); }
+void hostExitCritical(portMUX_TYPE*) { criticalMutex.unlock(); }
+
+//heap accounting: each block carries its size in front of the returned pointer
+//(atomic, as tests of the ESP32 async server run requests on a second thread)
+static std::atomic<uint32_t> heapUsedBytes(0), heapPeakBytes(0);
+static std::atomic<uint64_t> heapAllocs(0);
+static const size_t heapHeader = alignof(max_align_t);
+
+static void* heapAlloc(size_t n)
+{
+  char* p = (char*)malloc(n + heapHeader);
+  if (p == nullptr) throw std::bad_alloc();
+  *(size_t*)p = n;
+  uint32_t used = heapUsedBytes += n;
+  heapAllocs++;
+  if (used > heapPeakBytes) heapPeakBytes = used;
+  return p + heapHeader;
+}
+
+static void heapFree(void* ptr)
+{
+  if (ptr == nullptr) return;
+  char* p = (char*)ptr - heapHeader;
+  heapUsedBytes -= *(size_t*)p;
+  free(p);
+}
+
+void* operator new(size_t n) { return heapAlloc(n); }
+void* operator new[](size_t n) { return heapAlloc(n); }
+void operator delete(void* p) noexcept { heapFree(p); }
+void operator delete[](void* p) noexcept { heapFree(p); }
+void operator delete(void* p, size_t) noexcept { heapFree(p); }
+void operator delete[](void* p, size_t) noexcept { heapFree(p); }
+
+namespace host {
+  uint32_t heapUsed() { return heapUsedBytes; }
+  uint32_t heapPeak() { return heapPeakBytes; }
+  void resetHeapPeak() { heapPeakBytes = heapUsedBytes.load(); }
+  uint64_t allocations() { return heapAllocs; }
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+  return host::heapSize - heapUsedBytes;
+}
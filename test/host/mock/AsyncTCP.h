@@ -0,0 +1 @@
+//ESP32 AsyncTCP, nothing needed on the host
@@ -0,0 +1,105 @@
+//Host mock of the synchronous web server. Tests either call request() to serve a request right away,
+//or queue() requests that are served one per handleClient() call, like the real server does
+#ifndef ESP8266WebServer_h
+#define ESP8266WebServer_h
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+#include <deque>
+#include <vector>
+#include <utility>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+
+class ESP8266WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+  typedef std::vector<std::pair<std::string, std::string>> Headers;
+
+  struct Request {
+    HTTPMethod method = HTTP_GET;
+    std::string uri, body;
+    Headers headers;
+    std::shared_ptr<WiFiClient::Connection> conn; //nullptr: a new connection, closed after the response
+    uint64_t queuedAt = 0; //host::now() when queued
+  };
+
+  struct Response {
+    int code = 0;
+    std::string type, body;
+    Headers headers;
+    size_t wireBytes = 0; //status line, headers and body as they would be sent
+    uint64_t queuedAt = 0, servedAt = 0;
+    bool handled = false;
+    std::string header(const char* name) const
+    {
+      for (auto& h : headers) if (strcasecmp(h.first.c_str(), name) == 0) return h.second;
+      return "";
+    }
+  };
+
+  uint16_t port;
+  IPAddress address; //0.0.0.0 for all addresses
+  std::deque<Request> pending;
+  std::vector<Response> responses; //every response sent, in order
+  bool keepResponses = true; //false: queued requests' responses (without body) are only passed to onResponse, e.g. for heap measurements
+  std::function<void(const Response&)> onResponse;
+  std::string* bodySink = nullptr; //if set, bodies of responses that are not kept are appended here, e.g. to a buffer reserved up front so heap measurements are not affected
+
+  ESP8266WebServer(int port = 80);
+  ESP8266WebServer(IPAddress addr, int port = 80) : ESP8266WebServer(port) { address = addr; }
+  ~ESP8266WebServer();
+
+  void on(const String& uri, HTTPMethod method, THandlerFunction fn) { routes.push_back(Route{uri.c_str(), method, fn}); }
+  void on(const String& uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+  void onNotFound(THandlerFunction fn) { notFound = fn; }
+  void collectHeaders(const char* headerKeys[], const size_t count)
+  {
+    collected.clear();
+    for (size_t i = 0; i < count; i++) collected.push_back(headerKeys[i]);
+  }
+  void begin() { started = true; }
+  void close() { started = false; }
+  void handleClient();
+
+  void send(int code, const char* type = nullptr, const String& content = String(""));
+  void send(int code, const char* type, const char* content) { send(code, type, String(content)); }
+  void send(int code, const String& type, const String& content) { send(code, type.c_str(), content); }
+  void sendHeader(const String& name, const String& value, bool first = false) { pendingHeaders.push_back({name.c_str(), value.c_str()}); }
+  void setContentLength(size_t len) { contentLength = len; }
+  void sendContent(const String& s) { sendContent(s.c_str()); }
+  void sendContent(const char* s);
+
+  String uri() { return cur.uri.c_str(); }
+  HTTPMethod method() { return cur.method; }
+  int args() { return cur.body.empty() ? 0 : 1; }
+  String arg(int i) { return i == 0 ? String(cur.body.c_str()) : String(); }
+  String arg(const String& name) { return name == "plain" ? String(cur.body.c_str()) : String(); }
+  bool hasHeader(const String& name);
+  String header(const String& name);
+  WiFiClient& client() { return currentClient; }
+
+  //host interface
+  Response request(HTTPMethod method, const std::string& uri, const std::string& body = "", const Headers& headers = Headers());
+  void queue(HTTPMethod method, const std::string& uri, const std::string& body = "", std::shared_ptr<WiFiClient::Connection> conn = nullptr);
+  static ESP8266WebServer* at(uint16_t port); //server listening on port, nullptr if none
+  bool started = false;
+
+private:
+  struct Route { std::string uri; HTTPMethod method; THandlerFunction fn; };
+  std::vector<Route> routes;
+  THandlerFunction notFound;
+  std::vector<std::string> collected;
+  Headers pendingHeaders;
+  size_t contentLength = 0;
+  bool chunked = false;
+  bool immediate = false; //serving request(), which returns the response
+  Request cur;
+  Response res;
+  WiFiClient currentClient;
+
+  void dispatch(const Request& r);
+};
+
+#endif
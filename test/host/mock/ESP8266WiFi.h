@@ -0,0 +1,24 @@
+//Host mock of the WiFi interface, tests set the MAC and IP
+#ifndef ESP8266WiFi_h
+#define ESP8266WiFi_h
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+class WiFiClass {
+public:
+  uint8_t mac[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xF0};
+  IPAddress ip = IPAddress(192, 168, 1, 50);
+
+  uint8_t* macAddress(uint8_t* m) { memcpy(m, mac, 6); return m; }
+  String macAddress()
+  {
+    char s[18];
+    sprintf(s, "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return s;
+  }
+  IPAddress localIP() { return ip; }
+};
+extern WiFiClass WiFi;
+
+#endif
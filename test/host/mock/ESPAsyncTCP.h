@@ -0,0 +1 @@
+//ESP8266 ESPAsyncTCP, nothing needed on the host
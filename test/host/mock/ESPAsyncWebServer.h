@@ -0,0 +1,167 @@
+//Host mock of ESPAsyncWebServer, enough to build and drive the async variant of Espalexa
+#ifndef ESPAsyncWebServer_h
+#define ESPAsyncWebServer_h
+
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include <vector>
+#include <utility>
+
+enum WebRequestMethod { HTTP_GET = 0b1, HTTP_POST = 0b10, HTTP_DELETE = 0b100, HTTP_PUT = 0b1000, HTTP_PATCH = 0b10000, HTTP_HEAD = 0b100000, HTTP_OPTIONS = 0b1000000, HTTP_ANY = 0b1111111 };
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter {
+  String _name, _value;
+public:
+  AsyncWebParameter(const String& name, const String& value) : _name(name), _value(value) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+};
+
+class AsyncWebHeader {
+  String _name, _value;
+public:
+  AsyncWebHeader(const String& name, const String& value) : _name(name), _value(value) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+};
+
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebServerResponse {
+public:
+  AwsResponseFiller filler; //chunked response, the server calls it until it returns 0
+  int code = 0;
+  String type;
+  std::string body;
+  std::vector<std::pair<String, String>> headers;
+  virtual ~AsyncWebServerResponse() {}
+  void addHeader(const String& name, const String& value) { headers.push_back({name, value}); }
+  void setCode(int c) { code = c; }
+};
+
+//buffers the whole body until it is sent
+class AsyncResponseStream : public AsyncWebServerResponse, public Print {
+public:
+  using Print::write;
+  size_t write(uint8_t c) override { body.push_back(c); return 1; }
+  size_t write(const uint8_t* buf, size_t len) override { body.append((const char*)buf, len); return len; }
+};
+
+class AsyncWebServerRequest {
+public:
+  String _url, _contentType;
+  WebRequestMethodComposite _method = HTTP_GET;
+  std::vector<AsyncWebParameter> params;
+  std::vector<AsyncWebHeader> headers;
+  AsyncWebServerResponse* response = nullptr; //the response sent, owned by the request
+  bool keepBody = true; //false: only count the bytes of a chunked response in bodyBytes
+  size_t bodyBytes = 0;
+
+  ~AsyncWebServerRequest() { delete response; }
+  const String& url() const { return _url; }
+  String contentType() const { return _contentType; }
+  WebRequestMethodComposite method() const { return _method; }
+  bool hasParam(const String& name, bool post = false) const { return getParam(name, post) != nullptr; }
+  AsyncWebParameter* getParam(const String& name, bool post = false) const
+  {
+    for (auto& p : params) if (p.name() == name) return const_cast<AsyncWebParameter*>(&p);
+    return nullptr;
+  }
+  bool hasHeader(const String& name) const { return getHeader(name) != nullptr; }
+  AsyncWebHeader* getHeader(const String& name) const
+  {
+    for (auto& h : headers) if (h.name() == name) return const_cast<AsyncWebHeader*>(&h);
+    return nullptr;
+  }
+  AsyncWebServerResponse* beginResponse(int code, const String& type = String(), const String& content = String())
+  {
+    AsyncWebServerResponse* r = new AsyncWebServerResponse();
+    r->code = code;
+    r->type = type;
+    r->body = content.c_str();
+    return r;
+  }
+  AsyncResponseStream* beginResponseStream(const String& type, size_t bufferSize = 1460)
+  {
+    AsyncResponseStream* r = new AsyncResponseStream();
+    r->code = 200;
+    r->type = type;
+    return r;
+  }
+  AsyncWebServerResponse* beginChunkedResponse(const String& type, AwsResponseFiller filler)
+  {
+    AsyncWebServerResponse* r = beginResponse(200, type);
+    r->filler = filler;
+    return r;
+  }
+  //chunked responses are pulled right away, in pieces as small as a nearly full TCP window would allow
+  void send(AsyncWebServerResponse* r)
+  {
+    delete response;
+    response = r;
+    if (!r->filler) return;
+    uint8_t buf[64];
+    size_t n;
+    while ((n = r->filler(buf, sizeof(buf), bodyBytes)) > 0)
+    {
+      if (keepBody) r->body.append((const char*)buf, n);
+      bodyBytes += n;
+    }
+  }
+  void send(int code, const String& type = String(), const String& content = String()) { send(beginResponse(code, type, content)); }
+  void send(int code, const String& type, const __FlashStringHelper* content) { send(code, type, String(content)); }
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t*, size_t, size_t, size_t)> ArBodyHandlerFunction;
+
+class AsyncWebHandler {
+public:
+  virtual ~AsyncWebHandler() {}
+};
+
+class AsyncEventSource : public AsyncWebHandler {
+public:
+  struct Event { std::string data, event; uint32_t id; };
+  String url;
+  std::vector<Event> sent;
+  AsyncEventSource(const String& u) : url(u) {}
+  void send(const char* message, const char* event = nullptr, uint32_t id = 0, uint32_t reconnect = 0) { sent.push_back(Event{message, event ? event : "", id}); }
+  size_t count() const { return 1; }
+};
+
+class AsyncWebServer {
+public:
+  struct Route { String uri; WebRequestMethodComposite method; ArRequestHandlerFunction fn; };
+  uint16_t port;
+  std::vector<Route> routes;
+  std::vector<AsyncWebHandler*> handlers;
+  ArRequestHandlerFunction notFound;
+  ArBodyHandlerFunction bodyHandler;
+
+  AsyncWebServer(uint16_t p) : port(p) {}
+  void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction fn) { routes.push_back(Route{uri, method, fn}); }
+  void onNotFound(ArRequestHandlerFunction fn) { notFound = fn; }
+  void onRequestBody(ArBodyHandlerFunction fn) { bodyHandler = fn; }
+  AsyncWebHandler& addHandler(AsyncWebHandler* h) { handlers.push_back(h); return *h; }
+  void begin() {}
+
+  //host interface: runs the handler of a request like the async server does, the response is in request.response
+  void handle(AsyncWebServerRequest& request, const std::string& body = "")
+  {
+    if (bodyHandler && !body.empty()) bodyHandler(&request, (uint8_t*)body.data(), body.size(), 0, body.size());
+    for (auto& r : routes)
+    {
+      //like the real server, a route also matches URLs below it
+      if ((r.method & request.method()) && (request.url() == r.uri || request.url().startsWith(r.uri + "/")))
+      {
+        r.fn(&request);
+        return;
+      }
+    }
+    if (notFound) notFound(&request);
+  }
+};
+
+#endif
@@ -0,0 +1,13 @@
+//ESP32 name of the synchronous web server
+#ifndef WebServer_h
+#define WebServer_h
+
+#include "ESP8266WebServer.h"
+
+class WebServer : public ESP8266WebServer {
+public:
+  WebServer(int port = 80) : ESP8266WebServer(port) {}
+  WebServer(IPAddress addr, int port = 80) : ESP8266WebServer(addr, port) {}
+};
+
+#endif
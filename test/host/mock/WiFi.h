@@ -0,0 +1,2 @@
+//ESP32 name of the WiFi header
+#include "ESP8266WiFi.h"
@@ -0,0 +1,43 @@
+//Host mock of a TCP client. Copies share one connection, like WiFiClient on the ESP cores
+#ifndef WiFiClient_h
+#define WiFiClient_h
+
+#include "Arduino.h"
+#include <memory>
+
+class WiFiClient : public Stream {
+public:
+  struct Connection {
+    bool connected = true;
+    size_t incoming = 0;           //bytes of the next request waiting to be read
+    size_t writeSpace = (size_t)-1; //availableForWrite(), writes beyond it are lost
+    bool noDelay = false;
+    std::string out;               //everything written to the client
+  };
+  std::shared_ptr<Connection> conn;
+
+  WiFiClient() {}
+  explicit WiFiClient(std::shared_ptr<Connection> c) : conn(c) {}
+
+  uint8_t connected() { return conn && conn->connected; }
+  operator bool() { return conn != nullptr; }
+  void stop() { if (conn) conn->connected = false; }
+  int available() override { return connected() ? conn->incoming : 0; }
+  int read() override { return -1; }
+  void flush() {}
+  void setNoDelay(bool n) { if (conn) conn->noDelay = n; }
+  size_t availableForWrite() { return connected() ? conn->writeSpace : 0; }
+
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t len) override
+  {
+    if (!connected()) return 0;
+    if (len > conn->writeSpace) len = conn->writeSpace;
+    conn->out.append((const char*)buf, len);
+    if (conn->writeSpace != (size_t)-1) conn->writeSpace -= len;
+    return len;
+  }
+};
+
+#endif
@@ -0,0 +1,66 @@
+//Host mock of a UDP socket: tests queue datagrams with receive() and inspect the replies in sent
+#ifndef WiFiUdp_h
+#define WiFiUdp_h
+
+#include "Arduino.h"
+#include <deque>
+#include <vector>
+
+class WiFiUDP : public Print {
+public:
+  struct Datagram {
+    IPAddress ip;
+    uint16_t port;
+    std::string data;
+  };
+  std::deque<Datagram> inbox;
+  std::vector<Datagram> sent;
+  uint16_t localPort = 0;
+
+  WiFiUDP();
+  ~WiFiUDP();
+  uint8_t beginMulticast(IPAddress iface, IPAddress group, uint16_t port) { localPort = port; return 1; }
+  uint8_t beginMulticast(IPAddress group, uint16_t port) { localPort = port; return 1; }
+  void stop() { localPort = 0; }
+
+  int parsePacket()
+  {
+    if (inbox.empty()) return 0;
+    current = inbox.front();
+    inbox.pop_front();
+    readPos = 0;
+    return current.data.size();
+  }
+  int available() { return current.data.size() - readPos; }
+  int read(unsigned char* buf, size_t len)
+  {
+    size_t n = current.data.size() - readPos;
+    if (n > len) n = len;
+    memcpy(buf, current.data.data() + readPos, n);
+    readPos += n;
+    return n;
+  }
+  int read(char* buf, size_t len) { return read((unsigned char*)buf, len); }
+  IPAddress remoteIP() { return current.ip; }
+  uint16_t remotePort() { return current.port; }
+
+  int beginPacket(IPAddress ip, uint16_t port)
+  {
+    outgoing = Datagram{ip, port, std::string()};
+    return 1;
+  }
+  using Print::write;
+  size_t write(uint8_t c) override { outgoing.data.push_back(c); return 1; }
+  size_t write(const uint8_t* buf, size_t len) override { outgoing.data.append((const char*)buf, len); return len; }
+  int endPacket() { sent.push_back(outgoing); return 1; }
+
+  //host interface
+  void receive(const std::string& data, IPAddress from = IPAddress(192, 168, 1, 10), uint16_t port = 50000) { inbox.push_back(Datagram{from, port, data}); }
+  static WiFiUDP* bound(uint16_t port); //socket listening on port, nullptr if none
+
+private:
+  Datagram current, outgoing;
+  size_t readPos = 0;
+};
+
+#endif
@@ -0,0 +1,170 @@
+//Host mocks of the WiFi, UDP and web server classes
+#include "ESP8266WiFi.h"
+#include "WiFiUdp.h"
+#include "ESP8266WebServer.h"
+#include <algorithm>
+#include <strings.h>
+
+WiFiClass WiFi;
+
+static std::vector<WiFiUDP*>& udpSockets()
+{
+  static std::vector<WiFiUDP*> v;
+  return v;
+}
+
+WiFiUDP::WiFiUDP() { udpSockets().push_back(this); }
+
+WiFiUDP::~WiFiUDP()
+{
+  auto& v = udpSockets();
+  v.erase(std::remove(v.begin(), v.end(), this), v.end());
+}
+
+WiFiUDP* WiFiUDP::bound(uint16_t port)
+{
+  for (WiFiUDP* u : udpSockets()) if (u->localPort == port) return u;
+  return nullptr;
+}
+
+static std::vector<ESP8266WebServer*>& webServers()
+{
+  static std::vector<ESP8266WebServer*> v;
+  return v;
+}
+
+ESP8266WebServer::ESP8266WebServer(int p) : port(p) { webServers().push_back(this); }
+
+ESP8266WebServer::~ESP8266WebServer()
+{
+  auto& v = webServers();
+  v.erase(std::remove(v.begin(), v.end(), this), v.end());
+}
+
+ESP8266WebServer* ESP8266WebServer::at(uint16_t port)
+{
+  for (ESP8266WebServer* s : webServers()) if (s->port == port && s->started) return s;
+  return nullptr;
+}
+
+static const char* reason(int code)
+{
+  switch (code)
+  {
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 404: return "Not Found";
+    case 503: return "Service Unavailable";
+    default:  return "";
+  }
+}
+
+void ESP8266WebServer::send(int code, const char* type, const String& content)
+{
+  res.code = code;
+  if (type) res.type = type;
+  res.headers = pendingHeaders;
+  pendingHeaders.clear();
+  res.wireBytes = 9 + 4 + strlen(reason(code)) + 2; //status line
+  if (type) res.wireBytes += 16 + strlen(type);
+  for (auto& h : res.headers) res.wireBytes += h.first.size() + h.second.size() + 4;
+  if (contentLength == CONTENT_LENGTH_UNKNOWN)
+  {
+    chunked = true;
+    res.wireBytes += 28 + 2; //Transfer-Encoding: chunked, end of headers
+  } else {
+    if (keepResponses || immediate) res.body = content.c_str();
+    else if (bodySink) bodySink->append(content.c_str(), content.length());
+    res.wireBytes += 18 + std::to_string(content.length()).size() + 2 + content.length();
+  }
+  contentLength = 0;
+}
+
+void ESP8266WebServer::sendContent(const char* s)
+{
+  size_t len = strlen(s);
+  if (keepResponses || immediate) res.body.append(s, len);
+  else if (bodySink) bodySink->append(s, len);
+  char hex[20];
+  res.wireBytes += sprintf(hex, "%zx", len) + 2 + len + 2; //chunk framing, an empty chunk ends the response
+}
+
+bool ESP8266WebServer::hasHeader(const String& name)
+{
+  return header(name).length() > 0;
+}
+
+//like the real server, only headers passed to collectHeaders() are kept
+String ESP8266WebServer::header(const String& name)
+{
+  if (std::find(collected.begin(), collected.end(), std::string(name.c_str())) == collected.end()) return String();
+  for (auto& h : cur.headers) if (strcasecmp(h.first.c_str(), name.c_str()) == 0) return String(h.second.c_str());
+  return String();
+}
+
+void ESP8266WebServer::dispatch(const Request& r)
+{
+  cur = r;
+  res = Response();
+  res.queuedAt = r.queuedAt;
+  chunked = false;
+  contentLength = 0;
+  pendingHeaders.clear();
+  currentClient = WiFiClient(r.conn ? r.conn : std::make_shared<WiFiClient::Connection>());
+  std::string path = r.uri.substr(0, r.uri.find('?'));
+  bool found = false;
+  for (auto& route : routes)
+  {
+    if (route.uri == path && (route.method == HTTP_ANY || route.method == r.method))
+    {
+      route.fn();
+      found = true;
+      break;
+    }
+  }
+  if (!found)
+  {
+    if (notFound) notFound();
+    else send(404, "text/plain", "Not found");
+  }
+  res.handled = res.code != 0;
+  res.servedAt = host::now();
+  if (r.conn == nullptr && currentClient.conn.use_count() == 1) currentClient.stop(); //not kept alive and not taken over (e.g. by an event stream)
+  if (keepResponses) responses.push_back(res);
+  if (onResponse) onResponse(res);
+}
+
+ESP8266WebServer::Response ESP8266WebServer::request(HTTPMethod method, const std::string& uri, const std::string& body, const Headers& headers)
+{
+  Request r;
+  r.method = method;
+  r.uri = uri;
+  r.body = body;
+  r.headers = headers;
+  r.queuedAt = host::now();
+  immediate = true;
+  dispatch(r);
+  immediate = false;
+  return res;
+}
+
+void ESP8266WebServer::queue(HTTPMethod method, const std::string& uri, const std::string& body, std::shared_ptr<WiFiClient::Connection> conn)
+{
+  Request r;
+  r.method = method;
+  r.uri = uri;
+  r.body = body;
+  r.conn = conn;
+  r.queuedAt = host::now();
+  if (conn) conn->incoming++;
+  pending.push_back(r);
+}
+
+void ESP8266WebServer::handleClient()
+{
+  if (!started || pending.empty()) return;
+  Request r = pending.front();
+  pending.pop_front();
+  if (r.conn && r.conn->incoming) r.conn->incoming--;
+  dispatch(r);
+}
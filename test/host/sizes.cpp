@@ -0,0 +1,28 @@
+//Code and RAM of a sketch with the default configuration or, with -DMINIMAL, the MinimalConfig of configs.cpp. See the sizes target in the Makefile
+#include <Espalexa.h>
+
+#ifdef MINIMAL
+struct MinimalConfig : EspalexaDefaultConfig {
+  static const uint8_t maxDevices = 2;
+  static const bool statusPage = false;
+  static const bool colorSupport = false;
+};
+EspalexaT<MinimalConfig> espalexa;
+#else
+Espalexa espalexa;
+#endif
+
+void changed(EspalexaDevice*) {}
+
+void setup()
+{
+  espalexa.addDevice("Lamp", changed, EspalexaDeviceType::dimmable);
+  espalexa.addDevice("Fan", changed, EspalexaDeviceType::onoff);
+  espalexa.begin();
+}
+
+void loop()
+{
+  espalexa.loop();
+  delay(espalexa.nextServiceIn());
+}
@@ -0,0 +1,58 @@
+//Async server: lights and full state are pulled in chunks, memory use does not depend on the device count
+#define ESPALEXA_ASYNC
+#define ESPALEXA_MAXDEVICES 100
+#include <Espalexa.h>
+#include "HostTest.h"
+
+static void changed(uint8_t) {}
+
+//peak: heap used while answering, the body is then only counted and not kept
+static std::string get(AsyncWebServer& server, const char* url, uint32_t* peak = nullptr)
+{
+  AsyncWebServerRequest request;
+  request._url = url;
+  request.keepBody = peak == nullptr;
+  uint32_t start = host::heapUsed();
+  host::resetHeapPeak();
+  server.handle(request);
+  if (peak) *peak = host::heapPeak() - start;
+  return request.response ? request.response->body : std::string();
+}
+
+int main()
+{
+  AsyncWebServer server(80);
+  Espalexa espalexa;
+  server.onNotFound([&](AsyncWebServerRequest* request) {
+    if (!espalexa.handleAlexaApiCall(request)) request->send(404, "text/plain", "Not found");
+  });
+  espalexa.begin(&server);
+
+  uint32_t peak10 = 0, peak100 = 0;
+  for (int i = 0; i < 10; i++) espalexa.addDevice("Light " + String(i), changed);
+  std::string lights = get(server, "/api/user/lights");
+  get(server, "/api/user/lights", &peak10);
+  for (int i = 10; i < 100; i++) espalexa.addDevice("Light " + String(i), changed);
+  get(server, "/api/user/lights", &peak100);
+
+  //the chunked dict is the same as the single lights put together
+  std::string expected = "{";
+  for (int i = 0; i < 10; i++)
+  {
+    if (i) expected += ",";
+    expected += "\"" + std::to_string(lightKey(i)) + "\":" + get(server, lightUrl(i).c_str());
+  }
+  expected += "}";
+  CHECK_EQ(lights, expected);
+
+  std::string full = get(server, "/api/user");
+  CHECK(full.find("{\"lights\":{") == 0);
+  CHECK(full.find("\"config\":" + get(server, "/api/user/config")) != std::string::npos);
+  CHECK(full.size() > 100 * 250);
+
+  printf("async: peak heap of /lights %u bytes for 10 devices, %u for 100 (%u byte body)\n", peak10, peak100, (unsigned)get(server, "/api/user/lights").size());
+  CHECK_EQ(peak100, peak10);
+  CHECK(peak100 < 1024);
+
+  return testResult("async");
+}
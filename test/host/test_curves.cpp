@@ -0,0 +1,89 @@
+//Dimming curves: table accuracy against the formulas, PWM scaling, and cost per change compared to computing the curve with pow()
+#include <Espalexa.h>
+#include "HostTest.h"
+#include <cmath>
+
+static void changed(EspalexaDevice*) {}
+
+static double cie1931(double v) //relative luminance for lightness v (0-1)
+{
+  double l = v * 100;
+  return l <= 8 ? l / 903.3 : pow((l + 16) / 116, 3);
+}
+
+static double gamma22(double v) { return pow(v, 2.2); }
+
+static int maxError(EspalexaDevice& d, double (*f)(double))
+{
+  int worst = 0;
+  for (int v = 0; v < 256; v++)
+  {
+    d.setValue(v);
+    int expected = lround(f(v / 255.0) * 65535);
+    worst = std::max(worst, abs((int)d.getOutput() - expected));
+  }
+  return worst;
+}
+
+int main()
+{
+  EspalexaDevice d("Lamp", changed);
+  CHECK(d.getDimmingCurve() == EspalexaDimmingCurve::linear);
+  for (int v = 0; v < 256; v++)
+  {
+    d.setValue(v);
+    CHECK_EQ(d.getOutput(), (uint16_t)(v * 257));
+    CHECK_EQ(d.getOutput(8), (uint16_t)v);
+  }
+
+  //tables match the formulas to 1 LSB of 16 bits, start at 0, end at full and never decrease
+  const EspalexaDimmingCurve curves[] = {EspalexaDimmingCurve::cie1931, EspalexaDimmingCurve::gamma22};
+  double (*formulas[])(double) = {cie1931, gamma22};
+  for (int c = 0; c < 2; c++)
+  {
+    d.setDimmingCurve(curves[c]);
+    CHECK(d.getDimmingCurve() == curves[c]);
+    CHECK(maxError(d, formulas[c]) <= 1);
+    d.setValue(0);
+    CHECK_EQ(d.getOutput(), (uint16_t)0);
+    d.setValue(255);
+    CHECK_EQ(d.getOutput(), (uint16_t)65535);
+    uint16_t last = 0;
+    for (int v = 0; v < 256; v++)
+    {
+      d.setValue(v);
+      CHECK(d.getOutput() >= last);
+      last = d.getOutput();
+      //PWM resolutions are rounded from the 16 bit value
+      const uint8_t bits[] = {1, 8, 10, 12, 16};
+      for (uint8_t b : bits)
+      {
+        uint32_t max = (1UL << b) - 1;
+        CHECK_EQ((uint32_t)d.getOutput(b), (uint32_t)lround(d.getOutput() * (double)max / 65535));
+      }
+    }
+  }
+
+  //custom tables, and no table falls back to linear
+  static uint16_t table[256];
+  for (int v = 0; v < 256; v++) table[v] = 65535 - v * 257;
+  d.setDimmingCurve(EspalexaDimmingCurve::custom, table);
+  d.setValue(10);
+  CHECK_EQ(d.getOutput(), table[10]);
+  d.setDimmingCurve(EspalexaDimmingCurve::custom);
+  CHECK(d.getDimmingCurve() == EspalexaDimmingCurve::linear);
+
+  //cost per change: table lookup versus the curve computed in the callback
+  volatile uint32_t sink = 0;
+  d.setDimmingCurve(EspalexaDimmingCurve::gamma22);
+  double nsTable = benchNs(1000000, [&](uint32_t i) { d.setValue(i & 255); sink += d.getOutput(12); });
+  double nsPow = benchNs(1000000, [&](uint32_t i) { d.setValue(i & 255); sink += (uint16_t)lround(pow(d.getValue() / 255.0, 2.2) * 4095); });
+  d.setDimmingCurve(EspalexaDimmingCurve::cie1931);
+  double nsCie = benchNs(1000000, [&](uint32_t i) { d.setValue(i & 255); sink += d.getOutput(12); });
+  double nsCiePow = benchNs(1000000, [&](uint32_t i) { d.setValue(i & 255); sink += (uint16_t)lround(cie1931(d.getValue() / 255.0) * 4095); });
+  printf("curves: 12 bit output per change, gamma 2.2 %.1f ns from the table, %.1f ns with pow(); CIE 1931 %.1f ns, %.1f ns computed\n",
+    nsTable, nsPow, nsCie, nsCiePow);
+  CHECK(nsTable < nsPow);
+
+  return testResult("curves");
+}
@@ -0,0 +1,105 @@
+//Runtime device changes: slot reuse order, replaceDevice() ownership, duplicates, and heap after thousands of add/remove cycles
+#include <Espalexa.h>
+#include "HostTest.h"
+#include <random>
+
+static void changed(EspalexaDevice*) {}
+
+Espalexa espalexa;
+
+static std::string nameOf(ESP8266WebServer* server, uint8_t slot)
+{
+  std::string body = server->request(HTTP_GET, lightUrl(slot)).body;
+  size_t p = body.find("\"name\":\"");
+  if (p == std::string::npos) return "";
+  p += 8;
+  return body.substr(p, body.find('"', p) - p);
+}
+
+int main()
+{
+  espalexa.begin();
+  ESP8266WebServer* server = ESP8266WebServer::at(80);
+  server->keepResponses = false;
+  uint32_t heapBefore = host::heapUsed();
+
+  //slots that were never used come first, a removed slot is only reused when the table is full
+  CHECK_EQ(espalexa.addDevice("a", changed), 1);
+  CHECK_EQ(espalexa.addDevice("b", changed), 2);
+  CHECK_EQ(espalexa.addDevice("c", changed), 3);
+  CHECK(espalexa.removeDevice(2));
+  CHECK(!espalexa.removeDevice(2));
+  CHECK_EQ(espalexa.addDevice("d", changed), 4);
+  for (int i = 5; i <= ESPALEXA_MAXDEVICES; i++) CHECK_EQ(espalexa.addDevice("x", changed), i);
+  CHECK_EQ(espalexa.addDevice("e", changed), 2);
+  CHECK_EQ(espalexa.addDevice("f", changed), 0);
+
+  //replacing a device with itself keeps it owned, so removing it later frees it
+  EspalexaDevice* own = espalexa.getDevice(0);
+  CHECK(espalexa.replaceDevice(1, own));
+  CHECK(espalexa.removeDevice(1));
+  for (int i = 2; i <= ESPALEXA_MAXDEVICES; i++) CHECK(espalexa.removeDevice(i));
+  CHECK_EQ(host::heapUsed(), heapBefore);
+
+  //a device can only be in one slot
+  static EspalexaDevice fixed[3] = { {"one", changed}, {"two", changed}, {"three", changed} };
+  uint8_t id1 = espalexa.addDevice(&fixed[0]);
+  uint8_t id2 = espalexa.addDevice(&fixed[1]);
+  CHECK_EQ(espalexa.addDevice(&fixed[0]), 0);
+  CHECK(!espalexa.replaceDevice(id2, &fixed[0]));
+  CHECK(espalexa.getDevice(id2 -1) == &fixed[1]);
+  CHECK(espalexa.replaceDevice(id2, &fixed[2]));
+  CHECK_EQ(nameOf(server, id1 -1), "one");
+  CHECK_EQ(nameOf(server, id2 -1), "three");
+  CHECK_EQ(espalexa.addDevice(&fixed[2]), 0);
+  CHECK_EQ(espalexa.addDevice(&fixed[1]), 3); //no longer in a slot after it was replaced
+  CHECK(espalexa.removeDevice(3));
+  CHECK(espalexa.removeDevice(id1) && espalexa.removeDevice(id2));
+
+  //churn: random adds, removals and replacements of owned and static devices
+  static EspalexaDevice pool[ESPALEXA_MAXDEVICES];
+  for (int i = 0; i < ESPALEXA_MAXDEVICES; i++) pool[i] = EspalexaDevice("pool " + String(i), changed);
+  std::mt19937 rng(3);
+  uint32_t heapStart = host::heapUsed();
+  const int cycles = 20000;
+  int failures = 0;
+  for (int k = 0; k < cycles; k++)
+  {
+    uint8_t id = rng() % ESPALEXA_MAXDEVICES +1;
+    EspalexaDevice* d = espalexa.getDevice(id -1);
+    switch (rng() % 3)
+    {
+      case 0:
+        if (espalexa.addDevice("owned " + String(k), changed) == 0 && d == nullptr) failures++;
+        break;
+      case 1:
+        if (espalexa.removeDevice(id) != (d != nullptr)) failures++;
+        break;
+      case 2:
+      {
+        EspalexaDevice* p = &pool[rng() % ESPALEXA_MAXDEVICES];
+        bool inUse = false;
+        for (int i = 0; i < ESPALEXA_MAXDEVICES; i++) if (espalexa.getDevice(i) == p) inUse = true;
+        bool ok = espalexa.replaceDevice(id, p);
+        if (ok != (d != nullptr && (!inUse || d == p))) failures++;
+        break;
+      }
+    }
+    for (int i = 0; i < ESPALEXA_MAXDEVICES; i++)
+    {
+      EspalexaDevice* dev = espalexa.getDevice(i);
+      if (dev != nullptr && dev->getId() != i) failures++;
+    }
+  }
+  CHECK_EQ(failures, 0);
+  for (int i = 0; i < ESPALEXA_MAXDEVICES; i++)
+  {
+    EspalexaDevice* dev = espalexa.getDevice(i);
+    if (dev != nullptr) CHECK_EQ(nameOf(server, i), std::string(dev->getName().c_str()));
+  }
+  for (int i = 1; i <= ESPALEXA_MAXDEVICES; i++) espalexa.removeDevice(i);
+  printf("devices: %d add/remove/replace cycles, heap %u bytes before and %u after\n", cycles, heapStart, host::heapUsed());
+  CHECK_EQ(host::heapUsed(), heapStart);
+
+  return testResult("devices");
+}
@@ -0,0 +1,65 @@
+//Discovery: HTTP round trips a Hue client needs to learn all lights, with the full state and config answers and with the {} of 2.7.0
+#include <Espalexa.h>
+#include "HostTest.h"
+
+static void changed(uint8_t) {}
+void espalexaLoop();
+
+//a client that discovers the bridge, takes the full state if it has the lights and config, and falls back to single resources otherwise
+static int discover(ESP8266WebServer* server, bool answerEmpty, int lights)
+{
+  int requests = 0;
+  auto get = [&](const std::string& uri) {
+    requests++;
+    std::string body = server->request(HTTP_GET, uri).body;
+    if (answerEmpty && (uri == "/api/user" || uri == "/api/user/config")) return std::string("{}"); //2.7.0 answered {}
+    return body;
+  };
+
+  WiFiUDP* udp = WiFiUDP::bound(1900);
+  udp->receive("M-SEARCH * HTTP/1.1\r\nHOST: 239.255.255.250:1900\r\nMAN: \"ssdp:discover\"\r\nST: upnp:rootdevice\r\n\r\n");
+  udp->sent.clear();
+  espalexaLoop();
+  CHECK_EQ(udp->sent.size(), (size_t)1);
+
+  CHECK(get("/description.xml").find("<modelName>Philips hue bridge 2012</modelName>") != std::string::npos);
+  requests++;
+  CHECK(server->request(HTTP_POST, "/api", "{\"devicetype\":\"Echo\"}").body.find("username") != std::string::npos);
+
+  std::string state = get("/api/user");
+  if (state.find("\"lights\":{") != std::string::npos && state.find("\"config\":{") != std::string::npos) return requests;
+
+  CHECK(get("/api/user/config").size() > 2 || answerEmpty);
+  get("/api/user/lights");
+  for (int i = 0; i < lights; i++) get(lightUrl(i));
+  return requests;
+}
+
+Espalexa espalexa;
+void espalexaLoop() { espalexa.loop(); }
+
+int main()
+{
+  const int lights = 5;
+  for (int i = 0; i < lights; i++) espalexa.addDevice("Light " + String(i), changed);
+  espalexa.begin();
+  ESP8266WebServer* server = ESP8266WebServer::at(80);
+
+  //the full state holds the same lights and config as the single resources
+  std::string full = server->request(HTTP_GET, "/api/user").body;
+  std::string lightsJson = server->request(HTTP_GET, "/api/user/lights").body;
+  std::string config = server->request(HTTP_GET, "/api/user/config").body;
+  CHECK_EQ(full, "{\"lights\":" + lightsJson + ",\"groups\":{},\"config\":" + config +
+                 ",\"schedules\":{},\"scenes\":{},\"rules\":{},\"sensors\":{},\"resourcelinks\":{}}");
+  CHECK(config.find("\"mac\":\"AA:BB:CC:DD:EE:F0\"") != std::string::npos);
+  CHECK(config.find("\"bridgeid\":\"aabbccddeef0\"") != std::string::npos);
+  CHECK(config.find("\"ipaddress\":\"192.168.1.50\"") != std::string::npos);
+
+  int before = discover(server, true, lights);
+  int after = discover(server, false, lights);
+  printf("discovery of %d lights: %d HTTP requests with the {} answers of 2.7.0, %d with full state and config\n", lights, before, after);
+  CHECK_EQ(after, 3);
+  CHECK_EQ(before, 5 + lights);
+
+  return testResult("discovery");
+}
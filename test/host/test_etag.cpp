@@ -0,0 +1,68 @@
+//Conditional GET: 304 for unchanged lights, full state and single lights, and bytes and time per unchanged poll
+#include <Espalexa.h>
+#include "HostTest.h"
+
+static void changed(EspalexaDevice*) {}
+
+Espalexa espalexa;
+
+int main()
+{
+  for (int i = 0; i < ESPALEXA_MAXDEVICES; i++) espalexa.addDevice("Light " + String(i), changed, EspalexaDeviceType::extendedcolor);
+  espalexa.begin();
+  ESP8266WebServer* server = ESP8266WebServer::at(80);
+
+  const std::string urls[] = {"/api/user/lights", "/api/user", lightUrl(3)};
+  for (auto& url : urls)
+  {
+    ESP8266WebServer::Response full = server->request(HTTP_GET, url);
+    std::string etag = full.header("ETag");
+    CHECK_EQ(full.code, 200);
+    CHECK(etag.size() > 2);
+
+    ESP8266WebServer::Response cached = server->request(HTTP_GET, url, "", {{"If-None-Match", etag}});
+    CHECK_EQ(cached.code, 304);
+    CHECK_EQ(cached.body, "");
+    CHECK_EQ(cached.header("ETag"), etag);
+
+    //any device change makes the tag stale
+    espalexa.getDevice(7)->setValue(42);
+    ESP8266WebServer::Response fresh = server->request(HTTP_GET, url, "", {{"If-None-Match", etag}});
+    CHECK_EQ(fresh.code, 200);
+    CHECK(fresh.header("ETag") != etag);
+    CHECK(fresh.body.size() > 100);
+  }
+
+  //a change by Alexa too
+  std::string etag = server->request(HTTP_GET, "/api/user/lights").header("ETag");
+  server->request(HTTP_PUT, lightUrl(2) + "/state", "{\"on\":false}");
+  CHECK_EQ(server->request(HTTP_GET, "/api/user/lights", "", {{"If-None-Match", etag}}).code, 200);
+
+  //after a reboot the state version starts over, a tag from the last boot with the same version must not match
+  //(an instance begun later, on another port, with the same devices and state version stands in for the rebooted bridge)
+  etag = server->request(HTTP_GET, "/api/user/lights").header("ETag");
+  host::advance(2345678);
+  Espalexa rebooted;
+  for (int i = 0; i < ESPALEXA_MAXDEVICES; i++) rebooted.addDevice("Light " + String(i), changed, EspalexaDeviceType::extendedcolor);
+  rebooted.setBridge(0, 81);
+  rebooted.begin();
+  ESP8266WebServer* rebootedServer = ESP8266WebServer::at(81);
+  ESP8266WebServer::Response afterReboot = rebootedServer->request(HTTP_GET, "/api/user/lights", "", {{"If-None-Match", etag}});
+  CHECK_EQ(afterReboot.code, 200);
+  CHECK(afterReboot.header("ETag") != etag);
+  CHECK_EQ(rebootedServer->request(HTTP_GET, "/api/user/lights", "", {{"If-None-Match", afterReboot.header("ETag")}}).code, 304);
+
+  //bytes and time per poll of all lights
+  etag = server->request(HTTP_GET, "/api/user/lights").header("ETag");
+  ESP8266WebServer::Headers conditional = {{"If-None-Match", etag}};
+  size_t bytesFull = server->request(HTTP_GET, "/api/user/lights").wireBytes;
+  size_t bytesCached = server->request(HTTP_GET, "/api/user/lights", "", conditional).wireBytes;
+  double nsFull = benchNs(5000, [&](uint32_t) { server->request(HTTP_GET, "/api/user/lights"); });
+  double nsCached = benchNs(5000, [&](uint32_t) { server->request(HTTP_GET, "/api/user/lights", "", conditional); });
+  printf("etag: unchanged poll of %d lights: %u bytes and %.1f us with 304, %u bytes and %.1f us without\n",
+    ESPALEXA_MAXDEVICES, (unsigned)bytesCached, nsCached / 1000, (unsigned)bytesFull, nsFull / 1000);
+  CHECK(bytesCached * 20 < bytesFull);
+  CHECK(nsCached < nsFull);
+
+  return testResult("etag");
+}
@@ -0,0 +1,84 @@
+//Server-sent events: fan-out to 4 subscribers, slow subscribers skip lost events, no allocations per event
+#define ESPALEXA_EVENTS
+#include <Espalexa.h>
+#include "HostTest.h"
+#include <chrono>
+
+static void changed(EspalexaDevice*) {}
+
+Espalexa espalexa;
+
+static std::string lastData(const std::string& stream)
+{
+  size_t p = stream.rfind("data: ");
+  if (p == std::string::npos) return "";
+  return stream.substr(p + 6, stream.find('\n', p) - p - 6);
+}
+
+static size_t eventsIn(const std::string& stream)
+{
+  size_t n = 0;
+  for (size_t p = stream.find("event: change"); p != std::string::npos; p = stream.find("event: change", p + 1)) n++;
+  return n;
+}
+
+int main()
+{
+  espalexa.addDevice("Lamp", changed, EspalexaDeviceType::extendedcolor);
+  espalexa.begin();
+  ESP8266WebServer* server = ESP8266WebServer::at(80);
+
+  std::shared_ptr<WiFiClient::Connection> subs[5];
+  for (int i = 0; i < 5; i++)
+  {
+    subs[i] = std::make_shared<WiFiClient::Connection>();
+    subs[i]->out.reserve(1 << 20); //appending to the mock stream must not count as an allocation
+    server->queue(HTTP_GET, "/espalexa/events", "", subs[i]);
+    espalexa.loop();
+  }
+  for (int i = 0; i < 4; i++) CHECK(subs[i]->out.find("Content-Type: text/event-stream") != std::string::npos);
+  CHECK_EQ(server->responses.back().code, 503); //only Config::eventClients subscribers
+
+  //one change reaches all subscribers
+  server->request(HTTP_PUT, lightUrl(0) + "/state", "{\"on\":true,\"bri\":99}");
+  espalexa.loop();
+  std::string key = std::to_string(lightKey(0));
+  for (int i = 0; i < 4; i++)
+  {
+    CHECK_EQ(eventsIn(subs[i]->out), (size_t)1);
+    CHECK_EQ(lastData(subs[i]->out), "{\"id\":\"" + key + "\",\"changed\":\"bri\",\"on\":true,\"bri\":100,\"colormode\":\"xy\","
+                                     "\"hue\":0,\"sat\":0,\"ct\":500,\"xy\":[0.500000,0.500000]}");
+  }
+  CHECK(!espalexa.hasPendingWork());
+
+  //a subscriber that cannot take data keeps its place, and skips what fell out of the queue
+  subs[3]->writeSpace = 0;
+  for (int k = 1; k <= 20; k++) server->request(HTTP_PUT, lightUrl(0) + "/state", "{\"bri\":" + std::to_string(k) + "}");
+  espalexa.loop();
+  CHECK_EQ(eventsIn(subs[0]->out), (size_t)(1 + ESPALEXA_EVENT_QUEUE));
+  CHECK_EQ(eventsIn(subs[3]->out), (size_t)1);
+  subs[3]->writeSpace = (size_t)-1;
+  espalexa.loop();
+  CHECK_EQ(eventsIn(subs[3]->out), (size_t)(1 + ESPALEXA_EVENT_QUEUE));
+  CHECK(subs[3]->out.find("id: 14\n") != std::string::npos && subs[3]->out.find("id: 13\n") == std::string::npos);
+  CHECK_EQ(lastData(subs[3]->out), lastData(subs[0]->out));
+
+  //fan-out of single events to 4 subscribers
+  double ns = 0;
+  uint64_t allocs = 0;
+  const int n = 20000;
+  for (int k = 0; k < n; k++)
+  {
+    server->request(HTTP_PUT, lightUrl(0) + "/state", "{\"hue\":" + std::to_string(k % 65536) + ",\"sat\":200}");
+    uint64_t a = host::allocations();
+    auto start = std::chrono::steady_clock::now();
+    espalexa.loop();
+    ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    allocs += host::allocations() - a;
+    if (subs[0]->out.size() > 900000) for (int i = 0; i < 4; i++) subs[i]->out.clear();
+  }
+  printf("events: fan-out of one event to 4 subscribers %.2f us, %llu allocations in %d events\n", ns / n / 1000, (unsigned long long)allocs, n);
+  CHECK_EQ(allocs, (uint64_t)0);
+
+  return testResult("events");
+}
@@ -0,0 +1,56 @@
+//Server-sent events with the async server on ESP32: requests queue events on another task while loop() sends them
+#define ARDUINO_ARCH_ESP32
+#define ESPALEXA_ASYNC
+#define ESPALEXA_EVENTS
+#include <Espalexa.h>
+#include "HostTest.h"
+#include <thread>
+#include <atomic>
+
+static void changed(EspalexaDevice*) {}
+
+int main()
+{
+  AsyncWebServer server(80);
+  Espalexa espalexa;
+  server.onNotFound([&](AsyncWebServerRequest* request) { espalexa.handleAlexaApiCall(request); });
+  espalexa.addDevice("Lamp", changed, EspalexaDeviceType::extendedcolor);
+  espalexa.begin(&server);
+  CHECK_EQ(server.handlers.size(), (size_t)1);
+  AsyncEventSource* events = (AsyncEventSource*)server.handlers[0];
+
+  //stands in for the async_tcp task: every event has hue = 200 * (bri -1), a torn copy breaks that
+  const int n = 20000;
+  std::atomic<bool> done(false);
+  std::thread tcp([&]() {
+    for (int k = 0; k < n; k++)
+    {
+      int bri = k % 250 + 1;
+      AsyncWebServerRequest request;
+      request._url = lightUrl(0).c_str();
+      request._url += "/state";
+      server.handle(request, "{\"bri\":" + std::to_string(bri) + ",\"hue\":" + std::to_string(200 * bri) + ",\"sat\":200}");
+    }
+    done = true;
+  });
+  while (!done) espalexa.loop();
+  tcp.join();
+  espalexa.loop();
+
+  uint32_t lastId = 0;
+  int torn = 0;
+  for (auto& e : events->sent)
+  {
+    unsigned bri = 0, hue = 0;
+    sscanf(strstr(e.data.c_str(), "\"bri\":"), "\"bri\":%u", &bri);
+    sscanf(strstr(e.data.c_str(), "\"hue\":"), "\"hue\":%u", &hue);
+    if (hue != 200 * (bri -1)) torn++;
+    CHECK(e.id > lastId);
+    lastId = e.id;
+  }
+  printf("events: %u of %d events sent while queued from another thread, %d inconsistent\n", (unsigned)events->sent.size(), n, torn);
+  CHECK_EQ(torn, 0);
+  CHECK_EQ(lastId, (uint32_t)n);
+
+  return testResult("events_async");
+}
@@ -0,0 +1,85 @@
+//Heap statistics: every request is recorded once under its type, and budgets catch paths that use too much heap
+#define ESPALEXA_HEAP_STATS
+#include <Espalexa.h>
+#include "HostTest.h"
+
+static void changed(EspalexaDevice*) {}
+
+Espalexa espalexa;
+
+//heap budget per request type in bytes, and allocations per request on the host
+struct Budget { EspalexaRequestType type; const char* name; uint32_t bytes; uint32_t allocations; };
+
+int main()
+{
+  for (int i = 0; i < 5; i++) espalexa.addDevice("Light " + String(i), changed, EspalexaDeviceType::extendedcolor);
+  espalexa.begin();
+  ESP8266WebServer* server = ESP8266WebServer::at(80);
+  server->keepResponses = false; //heap of the mock's response log is not part of the request
+
+  struct Req { EspalexaRequestType type; HTTPMethod method; std::string uri, body; };
+  const Req reqs[] = {
+    {EspalexaRequestType::description, HTTP_GET, "/description.xml", ""},
+    {EspalexaRequestType::page, HTTP_GET, "/espalexa", ""},
+    {EspalexaRequestType::username, HTTP_POST, "/api", "{\"devicetype\":\"Echo\"}"},
+    {EspalexaRequestType::state, HTTP_PUT, lightUrl(1) + "/state", "{\"on\":true,\"bri\":120}"},
+    {EspalexaRequestType::light, HTTP_GET, lightUrl(1), ""},
+    {EspalexaRequestType::lights, HTTP_GET, "/api/user/lights", ""},
+    {EspalexaRequestType::config, HTTP_GET, "/api/user/config", ""},
+    {EspalexaRequestType::fullstate, HTTP_GET, "/api/user", ""},
+    {EspalexaRequestType::other, HTTP_GET, "/api/user/groups", ""},
+  };
+  //allocations include about 3 of the mock server per request. The status page builds its text with String concatenation
+  const Budget budgets[] = {
+    {EspalexaRequestType::description, "description", 256, 6},
+    {EspalexaRequestType::page, "page", 2048, 200},
+    {EspalexaRequestType::username, "username", 256, 6},
+    {EspalexaRequestType::state, "state", 256, 12},
+    {EspalexaRequestType::light, "light", 256, 8},
+    {EspalexaRequestType::lights, "lights", 256, 8},
+    {EspalexaRequestType::config, "config", 256, 8},
+    {EspalexaRequestType::fullstate, "fullstate", 256, 4},
+    {EspalexaRequestType::other, "other", 256, 6},
+  };
+  for (auto& b : budgets) espalexa.setHeapBudget(b.type, b.bytes);
+
+  const int rounds = 50;
+  for (auto& b : budgets)
+  {
+    uint64_t allocs = 0;
+    for (auto& r : reqs)
+    {
+      if (r.type != b.type) continue;
+      for (int i = 0; i < rounds; i++)
+      {
+        server->queue(r.method, r.uri, r.body);
+        uint64_t a = host::allocations();
+        espalexa.loop();
+        allocs += host::allocations() - a;
+      }
+    }
+    const EspalexaHeapStats& st = espalexa.getHeapStats(b.type);
+    printf("heap: %-11s %3u requests, peak %4u bytes (budget %4u), %.1f allocations/request\n", b.name, st.requests, st.peakHeapUsed, b.bytes, (double)allocs / rounds);
+    CHECK_EQ(st.requests, (uint32_t)rounds); //once per request, not again as "other"
+    CHECK_EQ(st.overBudget, (uint32_t)0);
+    CHECK(allocs <= (uint64_t)b.allocations * rounds);
+  }
+  CHECK_EQ(espalexa.getHeapStats(EspalexaRequestType::loop).requests, (uint32_t)(rounds * 9));
+
+  //the String copies of URI and body are part of the request they belong to
+  espalexa.resetHeapStats();
+  std::string longBody(600, ' ');
+  server->queue(HTTP_PUT, lightUrl(1) + "/state", "{\"bri\":120}" + longBody);
+  espalexa.loop();
+  CHECK(espalexa.getHeapStats(EspalexaRequestType::state).peakHeapUsed >= 600);
+  CHECK_EQ(espalexa.getHeapStats(EspalexaRequestType::other).requests, (uint32_t)0);
+
+  //a path over budget is counted, so a test can fail on it
+  espalexa.setHeapBudget(EspalexaRequestType::page, 64);
+  server->queue(HTTP_GET, "/espalexa");
+  espalexa.loop();
+  CHECK_EQ(espalexa.getHeapStats(EspalexaRequestType::page).overBudget, (uint32_t)1);
+  server->keepResponses = true;
+
+  return testResult("heap");
+}
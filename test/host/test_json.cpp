@@ -0,0 +1,145 @@
+//Device JSON: exact output compared to the printf-based serializer of Espalexa 2.7.0, and render rate of both
+#include <Espalexa.h>
+#include "HostTest.h"
+#include <random>
+
+//the serializer as it was before the type-specialized one, kept as reference
+static const char* refTypeString(EspalexaDeviceType t)
+{
+  switch (t)
+  {
+    case EspalexaDeviceType::dimmable:      return "Dimmable light";
+    case EspalexaDeviceType::whitespectrum: return "Color temperature light";
+    case EspalexaDeviceType::color:         return "Color light";
+    case EspalexaDeviceType::extendedcolor: return "Extended color light";
+    default:                                return "On/off light";
+  }
+}
+
+static const char* refModelidString(EspalexaDeviceType t)
+{
+  switch (t)
+  {
+    case EspalexaDeviceType::dimmable:      return "LWB010";
+    case EspalexaDeviceType::whitespectrum: return "LWT010";
+    case EspalexaDeviceType::color:         return "LST001";
+    case EspalexaDeviceType::extendedcolor: return "LCT015";
+    default:                                return "HASS321";
+  }
+}
+
+static const char* refModeString(EspalexaColorMode m)
+{
+  if (m == EspalexaColorMode::xy) return "xy";
+  if (m == EspalexaColorMode::hs) return "hs";
+  return "ct";
+}
+
+static void refDeviceJsonString(EspalexaDevice* dev, char* buf)
+{
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  char buf_lightid[28];
+  sprintf(buf_lightid, "%02X:%02X:%02X:%02X:%02X:%02X-%02X-00:11", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], dev->getId() + 1);
+
+  char buf_col[80] = "";
+  if (static_cast<uint8_t>(dev->getType()) > 2)
+    sprintf(buf_col, ",\"hue\":%u,\"sat\":%u,\"effect\":\"none\",\"xy\":[%f,%f]", dev->getHue(), dev->getSat(), dev->getX(), dev->getY());
+
+  char buf_ct[16] = "";
+  if (static_cast<uint8_t>(dev->getType()) > 1 && dev->getType() != EspalexaDeviceType::color)
+    sprintf(buf_ct, ",\"ct\":%u", dev->getCt());
+
+  char buf_cm[20] = "";
+  if (static_cast<uint8_t>(dev->getType()) > 1)
+    sprintf(buf_cm, "\",\"colormode\":\"%s", refModeString(dev->getColorMode()));
+
+  if (static_cast<uint8_t>(dev->getType()) == 0)
+  {
+    sprintf(buf, "{\"state\":{\"on\":%s,\"alert\":\"none\",\"reachable\":true},"
+                 "\"type\":\"%s\",\"name\":\"%s\",\"modelid\":\"%s\",\"manufacturername\":\"Philips\",\"uniqueid\":\"%s\",\"swversion\":\"espalexa-2.7.0\"}",
+      dev->getValue() ? "true" : "false", refTypeString(dev->getType()), dev->getName().c_str(), refModelidString(dev->getType()), buf_lightid);
+  } else {
+    sprintf(buf, "{\"state\":{\"on\":%s,\"bri\":%u%s%s,\"alert\":\"none%s\",\"mode\":\"homeautomation\",\"reachable\":true},"
+                 "\"type\":\"%s\",\"name\":\"%s\",\"modelid\":\"%s\",\"manufacturername\":\"Philips\",\"productname\":\"E%u"
+                 "\",\"uniqueid\":\"%s\",\"swversion\":\"espalexa-2.7.0\"}",
+      dev->getValue() ? "true" : "false", dev->getLastValue() - 1, buf_col, buf_ct, buf_cm, refTypeString(dev->getType()),
+      dev->getName().c_str(), refModelidString(dev->getType()), static_cast<uint8_t>(dev->getType()), buf_lightid);
+  }
+}
+
+static void changed(EspalexaDevice*) {}
+
+int main()
+{
+  Espalexa espalexa;
+  EspalexaDevice devices[5] = {
+    {"Lamp", changed, EspalexaDeviceType::onoff}, {"Lamp", changed, EspalexaDeviceType::dimmable},
+    {"Lamp", changed, EspalexaDeviceType::whitespectrum}, {"Lamp", changed, EspalexaDeviceType::color},
+    {"Lamp", changed, EspalexaDeviceType::extendedcolor}
+  };
+  espalexa.addDevices(devices);
+  espalexa.begin();
+  ESP8266WebServer* server = ESP8266WebServer::at(80);
+  CHECK(server != nullptr);
+  if (server == nullptr) return testResult("json");
+
+  //random states of all device types
+  std::mt19937 rng(1);
+  uint32_t compared = 0;
+  for (int k = 0; k < 400; k++)
+  {
+    for (uint8_t t = 0; t < 5; t++)
+    {
+      EspalexaDevice& d = devices[t];
+      d.setName(k % 3 ? "Kitchen light" : "x");
+      d.setValue(rng() % 256);
+      switch (rng() % 4)
+      {
+        case 1: d.setColor((uint16_t)(rng() % 65536), (uint8_t)(rng() % 256)); break;
+        case 2: d.setColor((uint16_t)(153 + rng() % 350)); break;
+        case 3: d.setColorXY((rng() % 100000) / 100000.0f, (rng() % 100000) / 100000.0f); break;
+      }
+      if (rng() % 5 == 0) d.setValue(0);
+
+      char expected[1024];
+      refDeviceJsonString(&d, expected);
+      CHECK_EQ(server->request(HTTP_GET, lightUrl(t)).body, std::string(expected));
+      compared++;
+    }
+  }
+  printf("json: %u renders identical to the printf serializer\n", compared);
+
+  //color coordinates out of range or NaN (black from setColor(0,0,0)) are clamped to 0-1
+  EspalexaDevice& color = devices[4];
+  color.setColor(0, 0, 0);
+  CHECK(server->request(HTTP_GET, lightUrl(4)).body.find("\"xy\":[0.000000,0.000000]") != std::string::npos);
+  server->request(HTTP_PUT, lightUrl(4) + "/state", "{\"xy\":[1e30,-0.5]}");
+  CHECK(server->request(HTTP_GET, lightUrl(4)).body.find("\"xy\":[1.000000,0.000000]") != std::string::npos);
+  color.setColorXY(INFINITY, -INFINITY);
+  CHECK(server->request(HTTP_GET, lightUrl(4)).body.find("\"xy\":[1.000000,0.000000]") != std::string::npos);
+
+  //render rate, all 5 devices per /lights request. The printf serializer answers /ref/lights the way Espalexa 2.7.0 built /lights,
+  //so both are timed through the mock server
+  server->on("/ref/lights", HTTP_GET, [&]() {
+    char buf[1024];
+    String json = "{";
+    for (uint8_t i = 0; i < 5; i++)
+    {
+      refDeviceJsonString(&devices[i], buf);
+      json += "\"" + String(lightKey(i)) + "\":";
+      json += buf;
+      if (i < 4) json += ",";
+    }
+    json += "}";
+    server->send(200, "application/json", json);
+  });
+  color.setColorXY(0.3f, 0.4f); //in range, where both agree
+  CHECK_EQ(server->request(HTTP_GET, "/ref/lights").body, server->request(HTTP_GET, "/api/user/lights").body);
+  double nsRef = benchNs(4000, [&](uint32_t) { server->request(HTTP_GET, "/ref/lights"); }) / 5;
+  double nsLights = benchNs(4000, [&](uint32_t) { server->request(HTTP_GET, "/api/user/lights"); }) / 5;
+  printf("json: /lights through the mock server, printf serializer %.0f devices/s, type-specialized %.0f devices/s\n", 1e9 / nsRef, 1e9 / nsLights);
+  CHECK(nsLights < nsRef);
+
+  return testResult("json");
+}
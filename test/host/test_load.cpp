@@ -0,0 +1,85 @@
+//Sync server load: requests/s and p99 latency of polling Echos with one client per loop() (2.7.0) and with httpMaxClients 4
+#include <Espalexa.h>
+#include "HostTest.h"
+
+static void changed(uint8_t) {}
+
+struct FourClients : EspalexaDefaultConfig {
+  static const uint8_t httpMaxClients = 4;
+};
+
+struct LoadResult {
+  double requestsPerSecond, p50, p99; //latency in ms
+};
+
+//echos poll on kept-alive connections: every 100 ms each sends /lights and two single lights back to back.
+//Serving a request takes 2 ms, the rest of the sketch loop 10 ms (all simulated time)
+template <class E>
+static LoadResult run(E& espalexa, uint16_t port, int echos)
+{
+  ESP8266WebServer* server = ESP8266WebServer::at(port);
+  server->responses.clear();
+  server->onResponse = [](const ESP8266WebServer::Response&) { host::advance(2000); };
+  std::vector<std::shared_ptr<WiFiClient::Connection>> conns;
+  for (int i = 0; i < echos; i++) conns.push_back(std::make_shared<WiFiClient::Connection>());
+
+  const uint64_t duration = 60 * 1000000ULL;
+  uint64_t start = host::now(), nextPoll = start;
+  while (host::now() - start < duration)
+  {
+    while (host::now() >= nextPoll)
+    {
+      for (auto& c : conns)
+      {
+        server->queue(HTTP_GET, "/api/user/lights", "", c);
+        server->queue(HTTP_GET, lightUrl(0), "", c);
+        server->queue(HTTP_GET, lightUrl(1), "", c);
+      }
+      nextPoll += 100000;
+    }
+    espalexa.loop();
+    delay(10);
+  }
+  uint64_t end = host::now();
+
+  std::vector<double> latency;
+  for (auto& r : server->responses) latency.push_back((r.servedAt - r.queuedAt) / 1000.0);
+  CHECK(!latency.empty());
+  server->onResponse = nullptr;
+  server->pending.clear();
+  return LoadResult{latency.size() * 1e6 / (end - start), percentile(latency, 50), percentile(latency, 99)};
+}
+
+Espalexa one;
+EspalexaT<FourClients> four;
+
+int main()
+{
+  for (int i = 0; i < 5; i++)
+  {
+    one.addDevice("Light " + String(i), changed);
+    four.addDevice("Light " + String(i), changed);
+  }
+  one.begin();
+  four.setBridge(1, 8080);
+  four.begin();
+
+  for (int echos = 1; echos <= 4; echos *= 2)
+  {
+    LoadResult a = run(one, 80, echos);
+    LoadResult b = run(four, 8080, echos);
+    printf("load: %d echos, 1 client/loop: %.0f req/s, p50 %.0f ms, p99 %.0f ms; 4 clients/loop: %.0f req/s, p50 %.0f ms, p99 %.0f ms\n",
+      echos, a.requestsPerSecond, a.p50, a.p99, b.requestsPerSecond, b.p50, b.p99);
+    CHECK(b.p99 <= a.p99);
+    CHECK(b.requestsPerSecond >= a.requestsPerSecond * 0.99);
+    if (echos == 4)
+    {
+      //120 requests/s offered: one client per loop() falls behind, four keep up
+      CHECK(b.requestsPerSecond > 115);
+      CHECK(b.p99 < 100);
+      CHECK(a.p99 > 10 * b.p99);
+    }
+  }
+
+  return testResult("load");
+}
@@ -0,0 +1,63 @@
+//Replay of captured Echo sessions: responses, queueing delay on the simulated clock, time and heap per request, and replay throughput.
+//build/test_replay <capture>... replays other captures instead of the sessions in sessions/
+#include <Espalexa.h>
+#include "Replay.h"
+
+Espalexa espalexa;
+
+int main(int argc, char** argv)
+{
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) files.push_back(argv[i]);
+  if (files.empty()) files = {"sessions/discovery.cap", "sessions/onoff.cap", "sessions/dim.cap", "sessions/color.cap", "sessions/group.cap"};
+
+  espalexa.begin();
+  Replayer<Espalexa> replayer(espalexa, ESP8266WebServer::at(80));
+  std::vector<std::vector<ReplayRecord>> sessions;
+  for (auto& f : files)
+  {
+    std::vector<ReplayRecord> records;
+    std::string error;
+    if (!loadCapture(f, records, error))
+    {
+      fprintf(stderr, "%s: %s\n", f.c_str(), error.c_str());
+      testFailures++;
+      continue;
+    }
+    sessions.push_back(records);
+
+    //the replay of a session answers every request as expected. A request arriving while the sketch sleeps waits up to an idle interval,
+    //requests queued behind it are served right after it as loop() is called again without sleeping
+    Replayer<Espalexa>::Result r = replayer.run(records, f);
+    printf("replay: %-22s %2u HTTP %u UDP, wait p50 %5.1f p99 %5.1f ms, service p50 %5.1f p99 %5.1f us, heap peak %u bytes\n",
+      f.c_str(), r.http, r.udp, percentile(r.waitMs, 50), percentile(r.waitMs, 99),
+      percentile(r.serviceUs, 50), percentile(r.serviceUs, 99), r.heapPeak);
+    CHECK_EQ(r.failures, (uint32_t)0);
+    CHECK(r.http + r.udp > 0);
+    for (size_t i = 0; i < r.waitMs.size(); i++) CHECK(r.waitMs[i] <= ESPALEXA_IDLE_INTERVAL + 5);
+    CHECK(percentile(r.serviceUs, 90) < 5000); //not p99, which is the slowest of a few dozen and hit by any preemption of the test
+    CHECK(r.heapPeak < host::heapSize / 8);
+  }
+
+  //throughput: all sessions replayed back to back, idle loop() calls between the requests included.
+  //Each pass leaves the heap as the one before did, so nothing leaks
+  const int passes = 50;
+  uint32_t requests = 0, failures = 0, heapFirstPass = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int p = 0; p < passes; p++)
+  {
+    for (auto& s : sessions)
+    {
+      Replayer<Espalexa>::Result r = replayer.run(s, "throughput");
+      requests += r.http + r.udp;
+      failures += r.failures;
+      if (p == 0) heapFirstPass = r.heapAfter;
+      else if (&s == &sessions.back()) CHECK_EQ(r.heapAfter, heapFirstPass);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("replay: %u requests in %d passes, %.0f requests/s\n", requests, passes, requests / seconds);
+  CHECK_EQ(failures, (uint32_t)0);
+
+  return testResult("replay");
+}
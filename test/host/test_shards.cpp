@@ -0,0 +1,142 @@
+//Devices spread over linked bridges: discovery of 50 bridges on addresses of their own, global ids of 500 devices, and state changes through each bridge's server
+#include <Espalexa.h>
+#include "HostTest.h"
+#include <set>
+
+struct ShardConfig : EspalexaDefaultConfig {
+  static const uint8_t maxDevices = 10;
+};
+
+const int bridgeCount = 50;
+const int deviceCount = bridgeCount * ShardConfig::maxDevices;
+
+EspalexaT<ShardConfig> bridges[bridgeCount];
+static int calls[deviceCount];
+
+static void changed(EspalexaDevice* d)
+{
+  calls[d->getGlobalId()]++;
+}
+
+static std::string field(const std::string& s, const std::string& name, char end)
+{
+  size_t p = s.find(name);
+  if (p == std::string::npos) return "";
+  p += name.size();
+  return s.substr(p, s.find(end, p) - p);
+}
+
+//light keys of a /lights response, in slot order
+static std::vector<std::string> keys(const std::string& lights)
+{
+  std::vector<std::string> k;
+  for (size_t p = lights.find("\":{\"state\""); p != std::string::npos; p = lights.find("\":{\"state\"", p + 1))
+  {
+    size_t q = lights.rfind('"', p - 1);
+    k.push_back(lights.substr(q + 1, p - q - 1));
+  }
+  return k;
+}
+
+int main()
+{
+  WiFi.mac[0] = 0x18; //a universally administered address, as on a real ESP
+  for (int b = 1; b < bridgeCount; b++)
+  {
+    bridges[b].setBridge(b, 8000 + b, IPAddress(192, 168, 1, 100 + b));
+    bridges[0].linkBridge(&bridges[b]);
+  }
+
+  //ids count on from one bridge to the next
+  for (int i = 1; i <= deviceCount; i++) CHECK_EQ(bridges[0].addDevice("Light " + String(i), changed, EspalexaDeviceType::dimmable), (uint16_t)i);
+  CHECK_EQ(bridges[0].addDevice("One too many", changed), (uint16_t)0);
+  CHECK_EQ(bridges[7].getDevice(3)->getName(), String("Light 74"));
+  CHECK(bridges[0].getDevice(73) == bridges[7].getDevice(3));
+  CHECK(bridges[0].getDevice(deviceCount) == nullptr);
+  CHECK_EQ(bridges[7].getDevice(3)->getId(), 3);
+  int misnumbered = 0;
+  for (int i = 0; i < deviceCount; i++) if (bridges[0].getDevice(i)->getGlobalId() != i) misnumbered++;
+  CHECK_EQ(misnumbered, 0);
+  for (int b = 0; b < bridgeCount; b++) CHECK(bridges[b].begin());
+
+  //one search is answered by every bridge through the shared socket
+  WiFiUDP* udp = WiFiUDP::bound(1900);
+  CHECK(udp != nullptr);
+  const char* search = "M-SEARCH * HTTP/1.1\r\nMAN: \"ssdp:discover\"\r\nST: urn:schemas-upnp-org:device:basic:1\r\n\r\n";
+  udp->receive(search);
+  bridges[0].loop();
+  CHECK_EQ(udp->sent.size(), (size_t)bridgeCount);
+  std::set<std::string> ids, locations;
+  for (auto& reply : udp->sent)
+  {
+    ids.insert(field(reply.data, "hue-bridgeid: ", '\r'));
+    locations.insert(field(reply.data, "LOCATION: ", '\r'));
+  }
+  CHECK_EQ(ids.size(), (size_t)bridgeCount);
+  CHECK_EQ(locations.size(), (size_t)bridgeCount);
+  CHECK(ids.count("18bbccddeef0"));
+  CHECK(locations.count("http://192.168.1.50:80/description.xml"));
+  CHECK(locations.count("http://192.168.1.149:8049/description.xml"));
+
+  //the first bridge hidden, the others are still found
+  bridges[0].setDiscoverable(false);
+  udp->sent.clear();
+  udp->receive(search);
+  bridges[0].loop();
+  CHECK_EQ(udp->sent.size(), (size_t)bridgeCount - 1);
+  for (auto& reply : udp->sent) CHECK(reply.data.find("LOCATION: http://192.168.1.50:80/") == std::string::npos);
+  bridges[0].setDiscoverable(true);
+
+  //each bridge has a locally administered MAC of its own, reported in its config and its lights' uniqueids, and its own address
+  std::set<std::string> macs;
+  for (int b = 0; b < bridgeCount; b++)
+  {
+    ESP8266WebServer* server = ESP8266WebServer::at(b ? 8000 + b : 80);
+    CHECK(server != nullptr);
+    IPAddress ip = b ? IPAddress(192, 168, 1, 100 + b) : IPAddress();
+    CHECK(server->address == ip);
+    std::string config = server->request(HTTP_GET, "/api/user/config").body;
+    CHECK_EQ(field(config, "\"ipaddress\":\"", '"'), std::string((b ? ip : WiFi.localIP()).toString().c_str()));
+    std::string mac = field(config, "\"mac\":\"", '"');
+    CHECK_EQ(mac.size(), (size_t)17);
+    CHECK_EQ(strtoul(mac.substr(0, 2).c_str(), nullptr, 16) & 0x02, b ? 2UL : 0UL);
+    macs.insert(mac);
+    std::string light = server->request(HTTP_GET, "/api/user/lights/" + keys(server->request(HTTP_GET, "/api/user/lights").body)[0]).body;
+    CHECK_EQ(field(light, "\"uniqueid\":\"", '-'), mac);
+  }
+  CHECK_EQ(macs.size(), (size_t)bridgeCount);
+
+  //Alexa drives every device through the bridge it was discovered on
+  for (int b = 0; b < bridgeCount; b++)
+  {
+    ESP8266WebServer* server = ESP8266WebServer::at(b ? 8000 + b : 80);
+    std::vector<std::string> k = keys(server->request(HTTP_GET, "/api/user/lights").body);
+    CHECK_EQ(k.size(), (size_t)ShardConfig::maxDevices);
+    for (size_t s = 0; s < k.size(); s++)
+    {
+      int bri = (b * ShardConfig::maxDevices + s) % 253 + 1;
+      CHECK_EQ(server->request(HTTP_PUT, "/api/user/lights/" + k[s] + "/state", "{\"on\":true,\"bri\":" + std::to_string(bri) + "}").code, 200);
+    }
+  }
+  for (int b = 0; b < bridgeCount; b++) bridges[b].loop();
+  int wrong = 0;
+  for (int i = 0; i < deviceCount; i++)
+  {
+    EspalexaDevice* d = bridges[0].getDevice(i);
+    if (calls[i] != 1 || d->getValue() != i % 253 + 2) wrong++; //bri 1-254 is value 2-255
+  }
+  CHECK_EQ(wrong, 0);
+
+  //changes by global id reach the bridge holding the device
+  bridges[0].renameDevice(250, "Renamed");
+  CHECK(bridges[24].getDevice(9)->getName() == "Renamed");
+  CHECK(bridges[0].removeDevice(250));
+  CHECK(bridges[24].getDevice(9) == nullptr);
+  CHECK(!bridges[0].removeDevice(250));
+  CHECK_EQ(bridges[0].addDevice("Back", changed), (uint16_t)250);
+  CHECK_EQ(bridges[0].getDevice(249)->getGlobalId(), 249);
+  CHECK(!bridges[0].removeDevice(deviceCount + 1));
+
+  printf("shards: %d devices on %d bridges, %u SSDP replies per search\n", deviceCount, bridgeCount, (unsigned)bridgeCount);
+  return testResult("shards");
+}
@@ -0,0 +1,89 @@
+//Sleeping between loop() calls: wakeups per minute of a sketch that waits nextServiceIn() ms, compared to delay(1)
+#define ESPALEXA_EVENTS
+#include <Espalexa.h>
+#include "HostTest.h"
+
+static void changed(uint8_t) {}
+
+Espalexa espalexa;
+
+//loop() calls in one simulated minute. Each iteration takes 100 us, then the sketch waits wait() ms
+template <typename F>
+static uint32_t wakeupsPerMinute(F wait)
+{
+  uint64_t end = host::now() + 60 * 1000000ULL;
+  uint32_t n = 0;
+  while (host::now() < end)
+  {
+    espalexa.loop();
+    host::advance(100);
+    n++;
+    delay(wait());
+  }
+  return n;
+}
+
+static uint32_t sleeping() { return wakeupsPerMinute([]() { return espalexa.nextServiceIn(); }); }
+
+int main()
+{
+  espalexa.addDevice("Lamp", changed);
+  espalexa.begin();
+  ESP8266WebServer* server = ESP8266WebServer::at(80);
+
+  uint32_t polling = wakeupsPerMinute([]() { return 1; });
+  uint32_t idle = sleeping();
+
+  //an Echo keeps its connection open after a request
+  auto echo = std::make_shared<WiFiClient::Connection>();
+  server->queue(HTTP_GET, "/api/user/lights", "", echo);
+  espalexa.loop();
+  CHECK_EQ(espalexa.nextServiceIn(), (uint32_t)0); //after serving a request, loop() looks for further queued ones right away
+  espalexa.loop();
+  CHECK(!espalexa.hasPendingWork());
+  CHECK_EQ(espalexa.nextServiceIn(), (uint32_t)ESPALEXA_WAIT_INTERVAL);
+  //requests sent back to back on it are served without waiting
+  server->queue(HTTP_GET, "/api/user/lights", "", echo);
+  server->queue(HTTP_GET, lightUrl(0), "", echo);
+  espalexa.loop();
+  CHECK_EQ(espalexa.nextServiceIn(), (uint32_t)0);
+  espalexa.loop();
+  CHECK_EQ(espalexa.nextServiceIn(), (uint32_t)0);
+  espalexa.loop();
+  CHECK_EQ(espalexa.nextServiceIn(), (uint32_t)ESPALEXA_WAIT_INTERVAL);
+  uint32_t keepAlive = sleeping();
+  echo->connected = false;
+  espalexa.loop();
+  CHECK_EQ(espalexa.nextServiceIn(), (uint32_t)ESPALEXA_IDLE_INTERVAL);
+
+  //an event subscriber whose TCP buffers are full
+  auto sub = std::make_shared<WiFiClient::Connection>();
+  server->queue(HTTP_GET, "/espalexa/events", "", sub);
+  espalexa.loop();
+  sub->writeSpace = 0;
+  server->request(HTTP_PUT, lightUrl(0) + "/state", "{\"on\":true}");
+  espalexa.loop();
+  espalexa.loop();
+  CHECK(!espalexa.hasPendingWork());
+  CHECK_EQ(espalexa.nextServiceIn(), (uint32_t)ESPALEXA_WAIT_INTERVAL);
+  uint32_t blocked = sleeping();
+  sub->writeSpace = (size_t)-1;
+  espalexa.loop();
+  CHECK(sub->out.find("event: change") != std::string::npos);
+  CHECK_EQ(espalexa.nextServiceIn(), (uint32_t)ESPALEXA_IDLE_INTERVAL);
+
+  //a burst of SSDP searches is worked off back to back
+  WiFiUDP* udp = WiFiUDP::bound(1900);
+  for (int i = 0; i < 3; i++) udp->receive("M-SEARCH * HTTP/1.1\r\nMAN: \"ssdp:discover\"\r\nST: ssdp:all\r\n\r\n");
+  int iterations = 0;
+  do { espalexa.loop(); iterations++; } while (espalexa.nextServiceIn() == 0 && iterations < 10);
+  CHECK_EQ(iterations, 4);
+
+  printf("sleep: wakeups per minute with delay(1) %u, idle %u, idle keep-alive connection %u, blocked subscriber %u\n", polling, idle, keepAlive, blocked);
+  CHECK(idle <= 60000 / ESPALEXA_IDLE_INTERVAL + 1);
+  CHECK(keepAlive <= 60000 / ESPALEXA_WAIT_INTERVAL + 1);
+  CHECK(blocked <= 60000 / ESPALEXA_WAIT_INTERVAL + 1);
+  CHECK(polling > 50 * idle);
+
+  return testResult("sleep");
+}
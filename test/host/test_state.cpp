@@ -0,0 +1,127 @@
+//Binary state export/import: round trip of 100 devices, deltas, rejected input, resync after a reboot, and bytes and time per delta
+#define ESPALEXA_MAXDEVICES 100
+#include <Espalexa.h>
+#include "HostTest.h"
+#include <random>
+
+static void changed(EspalexaDevice*) {}
+
+static bool sameState(EspalexaDevice& a, EspalexaDevice& b)
+{
+  return a.getValue() == b.getValue() && a.getLastValue() == b.getLastValue() && a.getColorMode() == b.getColorMode() &&
+         a.getHue() == b.getHue() && a.getSat() == b.getSat() && a.getCt() == b.getCt() && a.getX() == b.getX() && a.getY() == b.getY() &&
+         a.getRGB() == b.getRGB();
+}
+
+static uint32_t headerVersion(const uint8_t* buf)
+{
+  return buf[4] | (buf[5] << 8) | ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+}
+
+int main()
+{
+  static EspalexaDevice src[100], dst[100];
+  Espalexa a, b;
+  for (int i = 0; i < 100; i++)
+  {
+    EspalexaDeviceType t = (EspalexaDeviceType)(i % 5);
+    src[i] = EspalexaDevice("src", changed, t, i);
+    dst[i] = EspalexaDevice("dst", changed, t, 0);
+  }
+  a.addDevices(src);
+  b.addDevices(dst);
+
+  std::mt19937 rng(7);
+  for (int i = 0; i < 100; i++)
+  {
+    src[i].setColorXY((rng() % 100000) / 100000.0f, (rng() % 100000) / 100000.0f);
+    if (i % 3 == 0) src[i].setColor((uint16_t)(rng() % 65536), (uint8_t)(rng() % 256));
+    if (i % 7 == 0) src[i].setColor((uint16_t)(153 + i));
+    if (i % 11 == 0) src[i].setValue(0);
+    if (i % 13 == 0) src[i].setColor((uint8_t)(rng() % 256), (uint8_t)(rng() % 256), (uint8_t)(rng() % 256)); //exact RGB, not recomputed from x and y
+  }
+
+  //full snapshot
+  static uint8_t buf[ESPALEXA_STATE_HEADLEN + 100 * (1 + ESPALEXA_STATE_RECLEN)];
+  size_t n = a.exportState(buf, sizeof(buf));
+  CHECK_EQ(n, sizeof(buf));
+  CHECK_EQ(a.exportState(buf, sizeof(buf) - 1), (size_t)0); //too small
+  n = a.exportState(buf, sizeof(buf));
+  CHECK(b.importState(buf, n));
+  int differing = 0;
+  for (int i = 0; i < 100; i++) if (!sameState(src[i], dst[i])) differing++;
+  CHECK_EQ(differing, 0);
+
+  //delta of the devices changed since the snapshot
+  uint32_t since = headerVersion(buf);
+  CHECK_EQ(a.exportState(buf, sizeof(buf), since), (size_t)ESPALEXA_STATE_HEADLEN);
+  for (int i = 0; i < 10; i++) src[i * 10].setValue(i + 1);
+  n = a.exportState(buf, sizeof(buf), since);
+  CHECK_EQ(n, (size_t)(ESPALEXA_STATE_HEADLEN + 10 * (1 + ESPALEXA_STATE_RECLEN)));
+  CHECK_EQ(buf[3], 10);
+  CHECK(b.importState(buf, n));
+  differing = 0;
+  for (int i = 0; i < 100; i++) if (!sameState(src[i], dst[i])) differing++;
+  CHECK_EQ(differing, 0);
+
+  //nothing is applied from a delta with a bad record
+  uint8_t before = dst[0].getValue();
+  src[0].setValue(before + 1);
+  src[1].setValue(77);
+  n = a.exportState(buf, sizeof(buf), headerVersion(buf));
+  CHECK_EQ(buf[3], 2);
+  std::vector<uint8_t> bad(buf, buf + n);
+  bad[ESPALEXA_STATE_HEADLEN + 1 + ESPALEXA_STATE_RECLEN + 1] ^= 1; //type of the second record
+  CHECK(!b.importState(bad.data(), n));
+  bad.assign(buf, buf + n);
+  bad[ESPALEXA_STATE_HEADLEN + 1 + ESPALEXA_STATE_RECLEN + 4] = 4; //color mode of the second record
+  CHECK(!b.importState(bad.data(), n));
+  bad.assign(buf, buf + n);
+  bad[ESPALEXA_STATE_HEADLEN + 1 + ESPALEXA_STATE_RECLEN] = 100; //slot without device
+  CHECK(!b.importState(bad.data(), n));
+  CHECK(!b.importState(buf, n - 1)); //truncated
+  bad.assign(buf, buf + n);
+  bad[2]++; //format version
+  CHECK(!b.importState(bad.data(), n));
+  CHECK_EQ(dst[0].getValue(), before);
+  CHECK(b.importState(buf, n));
+  CHECK(sameState(src[0], dst[0]) && sameState(src[1], dst[1]));
+
+  //a delta of a later boot of the exporting side, or one following a lost delta, does not fit the imported state until a full snapshot was imported
+  since = headerVersion(buf);
+  host::advance(1234567);
+  a.begin();
+  src[2].setValue(9);
+  n = a.exportState(buf, sizeof(buf), since);
+  CHECK(!b.importState(buf, n));
+  CHECK(!sameState(src[2], dst[2]));
+  CHECK(b.importState(buf, a.exportState(buf, sizeof(buf))));
+  CHECK(sameState(src[2], dst[2]));
+  since = headerVersion(buf);
+  src[3].setValue(10);
+  n = a.exportState(buf, sizeof(buf), since);
+  CHECK(b.importState(buf, n));
+  src[4].setValue(11);
+  a.exportState(buf, sizeof(buf), headerVersion(buf)); //lost
+  src[5].setValue(12);
+  n = a.exportState(buf, sizeof(buf), headerVersion(buf));
+  CHECK(!b.importState(buf, n));
+
+  //a device changed after the state version was read is part of the next delta
+  since = EspalexaDevice::getStateVersion();
+  src[50].setValue(3);
+  n = a.exportState(buf, sizeof(buf), since);
+  CHECK_EQ(buf[3], 1);
+  CHECK(headerVersion(buf) >= since);
+
+  //bytes and time per delta of 10 out of 100 devices
+  CHECK(b.importState(buf, a.exportState(buf, sizeof(buf))));
+  since = headerVersion(buf);
+  for (int i = 0; i < 10; i++) src[i * 9].setValue(i + 20);
+  double nsExport = benchNs(20000, [&](uint32_t) { n = a.exportState(buf, sizeof(buf), since); });
+  double nsImport = benchNs(20000, [&](uint32_t) { b.importState(buf, n); });
+  printf("state: full snapshot %u bytes, delta of 10/100 devices %u bytes, export %.2f us, import %.2f us\n",
+    (unsigned)sizeof(buf), (unsigned)n, nsExport / 1000, nsImport / 1000);
+
+  return testResult("state");
+}
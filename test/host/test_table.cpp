@@ -0,0 +1,62 @@
+//Static device tables: addDevices() of 32 devices with names in PROGMEM uses no heap, compared to 32 addDevice(String, ...) calls
+#define ESPALEXA_MAXDEVICES 32
+#include <Espalexa.h>
+#include "HostTest.h"
+
+static void changed(EspalexaDevice*) {}
+
+Espalexa espalexa;
+
+//names longer than the short string buffer of std::string, so the String variant allocates as it does on the ESP
+#define LIGHTS(X) X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) \
+  X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31)
+#define LIGHT_NAME(i) const char name##i[] PROGMEM = "Living room light " #i;
+#define LIGHT_ENTRY(i) {FPSTR(name##i), changed, EspalexaDeviceType::dimmable},
+LIGHTS(LIGHT_NAME)
+
+typedef EspalexaDevice Table[ESPALEXA_MAXDEVICES];
+
+//constructed on the first call, so its construction is counted too
+static Table& table()
+{
+  static Table devices = { LIGHTS(LIGHT_ENTRY) };
+  return devices;
+}
+
+static void removeAll()
+{
+  for (int i = 1; i <= ESPALEXA_MAXDEVICES; i++) espalexa.removeDevice(i);
+}
+
+int main()
+{
+  espalexa.begin();
+
+  uint64_t allocations = host::allocations();
+  uint32_t heap = host::heapUsed();
+  CHECK_EQ(espalexa.addDevices(table()), (uint16_t)ESPALEXA_MAXDEVICES);
+  CHECK_EQ(host::allocations() - allocations, (uint64_t)0);
+  CHECK_EQ(host::heapUsed(), heap);
+  CHECK(espalexa.getDevice(31)->getName() == "Living room light 31");
+  removeAll();
+
+  allocations = host::allocations();
+  for (int i = 0; i < ESPALEXA_MAXDEVICES; i++) espalexa.addDevice("Living room light " + String(i), changed, EspalexaDeviceType::dimmable);
+  uint64_t stringAllocations = host::allocations() - allocations;
+  uint32_t stringHeap = host::heapUsed() - heap;
+  CHECK(stringAllocations >= (uint64_t)ESPALEXA_MAXDEVICES);
+  removeAll();
+  CHECK_EQ(host::heapUsed(), heap);
+
+  //boot time: adding all devices, then removing them for the next round
+  double nsTable = benchNs(20000, [](uint32_t) { espalexa.addDevices(table()); removeAll(); });
+  double nsString = benchNs(20000, [](uint32_t) {
+    for (int i = 0; i < ESPALEXA_MAXDEVICES; i++) espalexa.addDevice("Living room light " + String(i), changed, EspalexaDeviceType::dimmable);
+    removeAll();
+  });
+  printf("table: %d devices, static table %u bytes and 0 heap bytes, %.2f us to add; addDevice(String) %u heap bytes in %u allocations, %.2f us\n",
+    ESPALEXA_MAXDEVICES, (unsigned)sizeof(Table), nsTable / 1000, stringHeap, (unsigned)stringAllocations, nsString / 1000);
+  CHECK(nsTable < nsString);
+
+  return testResult("table");
+}
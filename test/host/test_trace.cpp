@@ -0,0 +1,70 @@
+//Request tracing: Chrome trace JSON of a state change, idle loops stay out of the ring buffer, and cost per trace event
+#include <Espalexa.h>
+#include "HostTest.h"
+
+static void changed(EspalexaDevice*) {}
+
+struct TraceConfig : EspalexaDefaultConfig {
+  static const bool trace = true;
+  static const uint16_t traceSize = 256;
+};
+
+Espalexa plain;
+EspalexaT<TraceConfig> traced;
+
+static size_t count(const std::string& s, const std::string& what)
+{
+  size_t n = 0;
+  for (size_t p = s.find(what); p != std::string::npos; p = s.find(what, p + 1)) n++;
+  return n;
+}
+
+//state URL of the first light, read from /lights as each bridge has its own light keys
+static std::string stateUrl(ESP8266WebServer* server)
+{
+  std::string lights = server->request(HTTP_GET, "/api/user/lights").body;
+  return "/api/user/lights/" + lights.substr(2, lights.find('"', 2) - 2) + "/state";
+}
+
+int main()
+{
+  plain.addDevice("Lamp", changed);
+  traced.addDevice("Lamp", changed);
+  plain.begin();
+  traced.setBridge(1, 8080);
+  traced.begin();
+  ESP8266WebServer* plainServer = ESP8266WebServer::at(80);
+  ESP8266WebServer* server = ESP8266WebServer::at(8080);
+  CHECK_EQ(plainServer->request(HTTP_GET, "/espalexa/trace").code, 404);
+
+  //one state change, then idle loops, which are not traced
+  server->queue(HTTP_PUT, stateUrl(server), "{\"on\":true,\"bri\":50}");
+  traced.loop();
+  for (int i = 0; i < 1000; i++) traced.loop();
+  std::string trace = server->request(HTTP_GET, "/espalexa/trace").body;
+  CHECK(trace.find("{\"traceEvents\":[{\"name\":") == 0);
+  CHECK(trace.rfind("]}") == trace.size() - 2);
+  size_t http = trace.find("{\"name\":\"http\"");
+  CHECK(http != std::string::npos);
+  trace = trace.substr(http); //events of the state change, after those of the GET in stateUrl()
+  const char* points[] = {"http", "state", "callback", "send"};
+  for (const char* p : points)
+  {
+    std::string name = std::string("{\"name\":\"") + p + "\",\"ph\":\"";
+    CHECK_EQ(count(trace, name + "B\""), (size_t)1);
+    CHECK_EQ(count(trace, name + "E\""), count(trace, name + "B\""));
+  }
+  CHECK_EQ(count(trace, "\"name\":\"request\",\"ph\":\"i\""), (size_t)1);
+  size_t eventsPerRequest = count(trace, "{\"name\":");
+  CHECK(eventsPerRequest < 20);
+
+  //cost per event: trace() in a tight loop, as the difference of whole requests with and without tracing is lost in their noise
+  const uint32_t n = 1000000;
+  double perEvent = benchNs(n, [](uint32_t i) { traced.trace(EspalexaTracePoint::callback, i & 1 ? 'E' : 'B'); });
+  printf("trace: %u events per state change, %.1f ns per event, %.0f ns per state change\n",
+    (unsigned)eventsPerRequest, perEvent, perEvent * eventsPerRequest);
+  CHECK(perEvent > 0);
+  CHECK(perEvent < 200);
+
+  return testResult("trace");
+}